@@ -6,6 +6,7 @@
 #include <inc/types.h>
 #include <inc/trap.h>
 #include <inc/memlayout.h>
+#include <inc/syscall.h>
 
 typedef int32_t envid_t;
 
@@ -38,9 +39,38 @@ enum {
 	ENV_NOT_RUNNABLE
 };
 
+// Flag for the perm argument of sys_ipc_send_pages: unmap the pages
+// from the sender instead of sharing them.  Lies outside PTE_SYSCALL.
+#define IPC_MOVE		0x1000
+
+// IPC ports.  A port ID has the same layout as an envid_t, with the
+// port's index in the low LOG2NPORT bits and a uniqueifier above.
+// Port IDs are always > 0.
+typedef int32_t portid_t;
+
+#define LOG2NPORT		6
+#define NPORT			(1 << LOG2NPORT)
+#define PORTX(portid)		((portid) & (NPORT - 1))
+
+// Scheduling priorities.  Higher values run first; the effective
+// priority is env_priority - env_nice, plus a boost that grows while a
+// runnable env waits so that low priorities are never starved.
+#define ENV_PRIO_MIN		0
+#define ENV_PRIO_MAX		31
+#define ENV_PRIO_DEFAULT	16
+#define ENV_NICE_MIN		(-20)
+#define ENV_NICE_MAX		19
+
+// Tickets for the stride scheduler (built with SCHED_STRIDE): each
+// runnable env gets CPU time in proportion to its tickets.
+#define ENV_TICKETS_DEFAULT	100
+#define ENV_TICKETS_MAX		10000
+#define STRIDE1			(1 << 20)	// Pass step for one ticket
+
 // Special environment types
 enum EnvType {
 	ENV_TYPE_USER = 0,
+	NENVTYPE		// Number of environment types
 };
 
 struct Env {
@@ -53,6 +83,18 @@ struct Env {
 	uint32_t env_runs;		// Number of times environment has run
 	int env_cpunum;			// The CPU that the env is running on
 
+	// Scheduling
+	int env_priority;		// Base priority, ENV_PRIO_MIN..MAX
+	int env_nice;			// Nice value, ENV_NICE_MIN..MAX
+	int env_boost;			// Aging boost while waiting to run
+	uint64_t env_cycles;		// TSC cycles spent in user mode
+	uint32_t env_tickets;		// Stride scheduling share
+	uint32_t env_stride;		// Pass increment per quantum
+	uint32_t env_pass;		// Stride scheduling virtual time
+	int env_rq;			// CPU whose run queue holds us, or -1
+	int env_rq_idx;			// Our index in that run queue
+	uint32_t env_cpumask;		// CPUs we may run on, bit i = cpus[i]
+
 	// Address space
 	pde_t *env_pgdir;		// Kernel virtual address of page dir
 
@@ -65,11 +107,42 @@ struct Env {
 	uint32_t env_ipc_value;		// Data value sent to us
 	envid_t env_ipc_from;		// envid of the sender
 	int env_ipc_perm;		// Perm of page mapping received
+	size_t env_ipc_npages;		// Pages in dstva window; pages received
 	envid_t env_senders[10];        // Array to store senders to this env [Lab7 challenge]
 	int senders_count;              // Keep track of how many senders want to send to us
 	uint32_t value_to_send;         // Value we want to send 
 	void *srcva_to_send;            // Page we may have to map to receiver
+	size_t npages_to_send;          // Number of pages starting at srcva_to_send
 	unsigned perm_for_send;         // Permissions for mapping 
+
+	// Port IPC
+	portid_t env_ipc_port;		// Port the last message arrived on, or 0
+	bool env_port_recving;		// Env is blocked receiving on ports
+	uint64_t env_port_mask;		// Port indexes being received on
+	portid_t env_port_sending;	// Port this env is blocked sending on
+	struct Env *env_port_link;	// Next sender queued on the same port
+
+	// Futex waiting
+	physaddr_t env_futex_pa;	// Physical address waited on (0 if none)
+	struct Env *env_futex_link;	// Next waiter in the same hash bucket
+
+	// Timed waits
+	bool env_timeout_armed;		// Env has a pending timeout
+	uint32_t env_timeout;		// Tick at which the wait times out
+	int32_t env_timeout_ret;	// What the wait returns if it times out
+	int env_timeout_cpu;		// CPU whose timer wheel holds the env
+	struct Env *env_timeout_link;	// Next env in the same wheel slot
+	struct Env **env_timeout_prev;	// Pointer to us in the wheel slot
+
+	// Statistics, readable by anyone through envs[]
+	uint64_t env_kcycles;		// TSC cycles spent in the kernel for us
+	uint32_t env_switches;		// Times a CPU switched to us
+	uint32_t env_pgfaults_user;	// Page faults passed to our upcall
+	uint32_t env_pgfaults_kernel;	// Page faults with no upcall to take them
+	uint32_t env_cow_faults;	// Write faults on PTE_COW pages
+	uint32_t env_ipc_sent;		// IPC messages we delivered
+	uint32_t env_ipc_recvd;		// IPC messages delivered to us
+	uint32_t env_nsyscall[NSYSCALLS]; // System calls made, by number
 };
 
 
@@ -16,6 +16,12 @@ enum {
 
 	E_IPC_NOT_RECV	,	// Attempt to send to env that is not recving
 	E_EOF		,	// Unexpected end of file
+	E_WOULD_BLOCK	,	// Operation would block (e.g. futex value changed)
+	E_TIMEOUT	,	// Timed wait expired
+	E_BAD_PORT	,	// Port doesn't exist or otherwise
+				// cannot be used by the requesting env
+	E_NO_FREE_PORT	,	// Attempt to create a new port beyond
+				// the maximum allowed
 
 	MAXERROR
 };
@@ -0,0 +1,45 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_INC_KLOG_H
+#define JOS_INC_KLOG_H
+
+#include <inc/types.h>
+#include <inc/mmu.h>
+
+// Kernel log levels, most severe first.
+enum {
+	KLOG_ERR = 0,
+	KLOG_WARN,
+	KLOG_INFO,		// Env lifecycle messages
+	KLOG_DEBUG,
+	NKLOGLEVEL
+};
+
+#define KLOG_TEXTLEN	112
+#define KLOG_NREC	511	// So that struct KLog fits in 16 pages
+
+// One log message.
+struct KLogRecord {
+	uint64_t kr_ns;		// Time logged, ns since boot
+	uint32_t kr_seq;	// Sequence number, from 1
+	uint8_t kr_level;	// KLOG_*
+	uint8_t kr_cpu;		// CPU that logged it
+	uint16_t kr_len;	// Length of kr_text
+	char kr_text[KLOG_TEXTLEN];	// Message, without newline
+};
+
+// The kernel log: the last KLOG_NREC messages, with message number
+// 'seq' in kl_rec[seq % KLOG_NREC].  Mapped read-only at ULOG.
+//
+// A reader racing with the kernel should check that a record's kr_seq
+// is the one it expected both before and after copying the record.
+struct KLog {
+	uint32_t kl_next;	// Sequence number of the next message
+	uint32_t kl_console;	// Messages at or below this level are
+				// also printed on the console
+	struct KLogRecord kl_rec[KLOG_NREC];
+};
+
+#define KLOG_SIZE	ROUNDUP(sizeof(struct KLog), PGSIZE)
+
+#endif	// !JOS_INC_KLOG_H
@@ -17,6 +17,10 @@
 #include <inc/memlayout.h>
 #include <inc/syscall.h>
 #include <inc/trap.h>
+#include <inc/prof.h>
+#include <inc/trace.h>
+#include <inc/klog.h>
+#include <inc/syslat.h>
 
 #define USED(x)		(void)(x)
 
@@ -29,6 +33,13 @@ void	umain(int argc, char **argv);
 extern const char *binaryname;
 extern const volatile struct Env envs[NENV];
 extern const volatile struct PageInfo pages[];
+extern const volatile struct KLog klog;
+
+// bench.c
+void	bench_report(const char *name, uint32_t *cycles, int n);
+
+// console.c
+size_t	cputs_nowait(const char *s, size_t len);
 
 // exit.c
 void	exit(void);
@@ -54,6 +65,29 @@ int	sys_page_map(envid_t src_env, void *src_pg,
 int	sys_page_unmap(envid_t env, void *pg);
 int	sys_ipc_send(envid_t to_env, uint32_t value, void *pg, int perm);
 int	sys_ipc_recv(void *rcv_pg);
+int	sys_ipc_send_pages(envid_t to_env, uint32_t value, void *pg,
+			   size_t npages, int perm);
+int	sys_ipc_recv_pages(void *rcv_pg, size_t npages);
+int	sys_ipc_try_recv(void *rcv_pg);
+int	sys_ipc_recv_timed(void *rcv_pg, unsigned int nticks);
+int	sys_futex_wait(uint32_t *va, uint32_t expected);
+int	sys_futex_wake(uint32_t *va, int n);
+portid_t sys_port_create(int priority);
+int	sys_port_grant(portid_t port, envid_t env);
+int	sys_port_destroy(portid_t port);
+int	sys_port_send(portid_t port, uint32_t value, void *pg, int perm);
+int	sys_port_recv(const portid_t *ports, int nports, void *rcv_pg);
+envid_t	sys_env_lookup_type(enum EnvType type);
+uint64_t sys_time_ns(void);
+int	sys_sleep(uint64_t ns);
+int	sys_env_set_priority(envid_t env, int priority, int nice);
+int	sys_env_set_tickets(envid_t env, uint32_t tickets);
+int	sys_env_set_affinity(envid_t env, uint32_t cpumask);
+int	sys_prof(int op, struct ProfHot *buf, size_t n);
+int	sys_trace(int op);
+int	sys_klog_set_console(int level);
+int	sys_cputs_nowait(const char *string, size_t len);
+int	sys_syslat(int op, uint32_t syscallno, uint32_t *hist);
 
 // This must be inlined.  Exercise for reader: why?
 static inline envid_t __attribute__((always_inline))
@@ -69,13 +103,32 @@ sys_exofork(void)
 // ipc.c
 void	ipc_send(envid_t to_env, uint32_t value, void *pg, int perm);
 int32_t ipc_recv(envid_t *from_env_store, void *pg, int *perm_store);
+int	ipc_try_recv(envid_t *from_env_store, void *pg, int *perm_store,
+		     uint32_t *value_store);
+int	ipc_recv_timed(envid_t *from_env_store, void *pg, int *perm_store,
+		       uint32_t *value_store, unsigned int nticks);
+void	ipc_send_pages(envid_t to_env, uint32_t value, void *pg,
+		       size_t npages, int perm);
+int32_t	ipc_recv_pages(envid_t *from_env_store, void *pg, size_t npages,
+		       size_t *npages_store, int *perm_store);
 envid_t	ipc_find_env(enum EnvType type);
+int	port_send(portid_t port, uint32_t value, void *pg, int perm);
+int	port_recv(const portid_t *ports, int nports, portid_t *port_store,
+		  envid_t *from_env_store, void *pg, int *perm_store,
+		  uint32_t *value_store);
 
 // fork.c
 #define	PTE_SHARE	0x400
 envid_t	fork(void);
 envid_t	sfork(void);	// Challenge!
 
+// mutex.c
+struct Mutex {
+	volatile uint32_t mu_state;	// 0 free, 1 held, 2 held with waiters
+};
+void	mutex_init(struct Mutex *mu);
+void	mutex_lock(struct Mutex *mu);
+void	mutex_unlock(struct Mutex *mu);
 
 
 /* File open modes */
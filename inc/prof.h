@@ -0,0 +1,29 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_INC_PROF_H
+#define JOS_INC_PROF_H
+
+#include <inc/types.h>
+#include <inc/env.h>
+
+// Operations for sys_prof.
+enum {
+	PROF_START = 0,		// Discard old samples and start sampling
+	PROF_STOP,		// Stop sampling
+	PROF_REPORT,		// Print the hottest spots on the console
+	PROF_READ,		// Copy the hottest spots to a user buffer
+};
+
+// One hot spot: all the timer samples that landed in a kernel function,
+// or at a user address in one environment.
+struct ProfHot {
+	uintptr_t ph_eip;	// Kernel function address, or user EIP
+	envid_t ph_env;		// Env interrupted in user mode, or 0
+	uint32_t ph_count;	// Number of samples
+};
+
+// Most distinct hot spots the kernel keeps, and so returns from
+// PROF_READ.
+#define PROF_NHOT	128
+
+#endif	// !JOS_INC_PROF_H
@@ -16,6 +16,28 @@ enum {
 	SYS_yield,
 	SYS_ipc_send,
 	SYS_ipc_recv,
+	SYS_ipc_send_pages,
+	SYS_ipc_recv_pages,
+	SYS_ipc_try_recv,
+	SYS_ipc_recv_timed,
+	SYS_futex_wait,
+	SYS_futex_wake,
+	SYS_port_create,
+	SYS_port_grant,
+	SYS_port_destroy,
+	SYS_port_send,
+	SYS_port_recv,
+	SYS_env_lookup_type,
+	SYS_time_ns,
+	SYS_sleep,
+	SYS_env_set_priority,
+	SYS_env_set_tickets,
+	SYS_env_set_affinity,
+	SYS_prof,
+	SYS_trace,
+	SYS_klog_set_console,
+	SYS_cputs_nowait,
+	SYS_syslat,
 	NSYSCALLS
 };
 
@@ -0,0 +1,20 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_INC_SYSLAT_H
+#define JOS_INC_SYSLAT_H
+
+#include <inc/types.h>
+
+// Operations for sys_syslat.
+enum {
+	SYSLAT_START = 0,	// Clear the histograms and start recording
+	SYSLAT_STOP,		// Stop recording
+	SYSLAT_REPORT,		// Print percentiles on the console
+	SYSLAT_READ,		// Copy out one syscall's histogram
+};
+
+// Bucket i of a latency histogram counts system calls that took
+// [2^i, 2^(i+1)) TSC cycles; bucket 0 also counts those that took 0.
+#define SYSLAT_NBUCKET	32
+
+#endif	// !JOS_INC_SYSLAT_H
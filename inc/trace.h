@@ -0,0 +1,38 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_INC_TRACE_H
+#define JOS_INC_TRACE_H
+
+#include <inc/types.h>
+#include <inc/env.h>
+
+// Operations for sys_trace.
+enum {
+	TRACE_START = 0,	// Discard old events and start tracing
+	TRACE_STOP,		// Stop tracing
+	TRACE_DUMP,		// Dump the trace buffers on the console
+};
+
+// Event types.
+enum {
+	TE_RUN = 1,		// env_run switched to te_env; arg 0: previous env
+	TE_IDLE,		// CPU halted for lack of work
+	TE_SYSCALL,		// Syscall entry; arg 0: syscall number
+	TE_SYSRET,		// Syscall exit; arg 0: number, arg 1: result
+	TE_TRAP,		// Trap or interrupt; arg 0: trapno, arg 1: eip
+	TE_PGFLT,		// User page fault; arg 0: fault va, arg 1: err
+	TE_IPC_SEND,		// IPC delivered; arg 0: receiver, arg 1: value
+	TE_IPC_RECV,		// Receiver blocked waiting for IPC
+};
+
+// One trace event.  Dumped as six little-endian 32-bit words; see
+// trace2json.py.
+struct TraceEvent {
+	uint64_t te_tsc;	// Time stamp counter when recorded
+	uint16_t te_type;	// TE_*
+	uint16_t te_cpu;	// CPU that recorded it
+	envid_t te_env;		// Env the event concerns, or 0
+	uint32_t te_arg[2];
+};
+
+#endif	// !JOS_INC_TRACE_H
@@ -9,9 +9,15 @@
 #include <kern/console.h>
 #include <kern/trap.h>
 #include <kern/picirq.h>
+#include <kern/spinlock.h>
 
 static void cons_intr(int (*proc)(void));
 static void cons_putc(int c);
+static void cons_puts(const char *s);
+static void cons_lock(void);
+static void cons_unlock(void);
+static void serial_tx(void);
+static void lpt_tx(void);
 
 // Stupid I/O delay routine necessitated by historical PC design flaws
 static void
@@ -33,8 +39,12 @@ delay(void)
 #define COM_DLM		1	// Out: Divisor Latch High (DLAB=1)
 #define COM_IER		1	// Out: Interrupt Enable Register
 #define   COM_IER_RDI	0x01	//   Enable receiver data interrupt
+#define   COM_IER_TEI	0x02	//   Enable transmitter empty interrupt
 #define COM_IIR		2	// In:	Interrupt ID Register
+#define   COM_IIR_FIFO	0xC0	//   FIFOs enabled
 #define COM_FCR		2	// Out: FIFO Control Register
+#define   COM_FCR_ENABLE 0x01	//   Enable FIFOs
+#define   COM_FCR_CLEAR	0x06	//   Clear receive and transmit FIFOs
 #define COM_LCR		3	// Out: Line Control Register
 #define	  COM_LCR_DLAB	0x80	//   Divisor latch access bit
 #define	  COM_LCR_WLEN8	0x03	//   Wordlength: 8 bits
@@ -48,6 +58,8 @@ delay(void)
 #define   COM_LSR_TSRE	0x40	//   Transmitter off
 
 static bool serial_exists;
+static int serial_fifo;		// Bytes we may write once TXRDY is set
+static uint8_t serial_ier;	// Current COM_IER value
 
 static int
 serial_proc_data(void)
@@ -57,11 +69,30 @@ serial_proc_data(void)
 	return inb(COM1+COM_RX);
 }
 
-void
-serial_intr(void)
+// Take in received characters and send more buffered output.
+static void
+serial_poll(void)
 {
 	if (serial_exists)
 		cons_intr(serial_proc_data);
+	serial_tx();
+	lpt_tx();
+}
+
+void
+serial_intr(void)
+{
+	cons_lock();
+	serial_poll();
+	cons_unlock();
+}
+
+static void
+serial_set_ier(uint8_t ier)
+{
+	if (serial_exists && ier != serial_ier)
+		outb(COM1+COM_IER, ier);
+	serial_ier = ier;
 }
 
 static void
@@ -80,8 +111,8 @@ serial_putc(int c)
 static void
 serial_init(void)
 {
-	// Turn off the FIFO
-	outb(COM1+COM_FCR, 0);
+	// Turn on the FIFOs, interrupting on every received byte
+	outb(COM1+COM_FCR, COM_FCR_ENABLE | COM_FCR_CLEAR);
 
 	// Set speed; requires DLAB latch
 	outb(COM1+COM_LCR, COM_LCR_DLAB);
@@ -95,13 +126,17 @@ serial_init(void)
 	outb(COM1+COM_MCR, 0);
 	// Enable rcv interrupts
 	outb(COM1+COM_IER, COM_IER_RDI);
+	serial_ier = COM_IER_RDI;
 
 	// Clear any preexisting overrun indications and interrupts
 	// Serial port doesn't exist if COM_LSR returns 0xFF
 	serial_exists = (inb(COM1+COM_LSR) != 0xFF);
-	(void) inb(COM1+COM_IIR);
+	// An 8250 or 16450 has no transmit FIFO
+	serial_fifo = (inb(COM1+COM_IIR) & COM_IIR_FIFO) == COM_IIR_FIFO ? 16 : 1;
 	(void) inb(COM1+COM_RX);
 
+	if (serial_exists)
+		irq_setmask_8259A(irq_mask_8259A & ~(1<<IRQ_SERIAL));
 }
 
 
@@ -127,9 +162,19 @@ lpt_putc(int c)
 
 /***** Text-mode CGA/VGA display output *****/
 
+// Characters are written to a shadow of the screen in ordinary memory,
+// and the range of cells that changed is copied to video memory, and
+// the cursor moved, only by cga_flush, once per console write.  A
+// scroll is a single memmove of the shadow, and marks the whole screen
+// dirty.
+
 static unsigned addr_6845;
 static uint16_t *crt_buf;
 static uint16_t crt_pos;
+static uint16_t crt_shadow[CRT_SIZE];
+static uint16_t crt_dirty_lo = CRT_SIZE;	// Dirty cells are
+static uint16_t crt_dirty_hi;			// [crt_dirty_lo, crt_dirty_hi)
+static uint16_t crt_cursor;			// Cursor position on screen
 
 static void
 cga_init(void)
@@ -157,9 +202,16 @@ cga_init(void)
 
 	crt_buf = (uint16_t*) cp;
 	crt_pos = pos;
+	crt_cursor = pos;
+	memmove(crt_shadow, crt_buf, sizeof(crt_shadow));
 }
 
-
+static void
+cga_dirty(uint16_t lo, uint16_t hi)
+{
+	crt_dirty_lo = MIN(crt_dirty_lo, lo);
+	crt_dirty_hi = MAX(crt_dirty_hi, hi);
+}
 
 static void
 cga_putc(int c)
@@ -172,7 +224,8 @@ cga_putc(int c)
 	case '\b':
 		if (crt_pos > 0) {
 			crt_pos--;
-			crt_buf[crt_pos] = (c & ~0xff) | ' ';
+			crt_shadow[crt_pos] = (c & ~0xff) | ' ';
+			cga_dirty(crt_pos, crt_pos + 1);
 		}
 		break;
 	case '\n':
@@ -182,14 +235,16 @@ cga_putc(int c)
 		crt_pos -= (crt_pos % CRT_COLS);
 		break;
 	case '\t':
-		cons_putc(' ');
-		cons_putc(' ');
-		cons_putc(' ');
-		cons_putc(' ');
-		cons_putc(' ');
+		cga_putc(' ');
+		cga_putc(' ');
+		cga_putc(' ');
+		cga_putc(' ');
+		cga_putc(' ');
 		break;
 	default:
-		crt_buf[crt_pos++] = c;		/* write the character */
+		crt_shadow[crt_pos] = c;	/* write the character */
+		cga_dirty(crt_pos, crt_pos + 1);
+		crt_pos++;
 		break;
 	}
 
@@ -197,17 +252,34 @@ cga_putc(int c)
 	if (crt_pos >= CRT_SIZE) {
 		int i;
 
-		memmove(crt_buf, crt_buf + CRT_COLS, (CRT_SIZE - CRT_COLS) * sizeof(uint16_t));
+		memmove(crt_shadow, crt_shadow + CRT_COLS, (CRT_SIZE - CRT_COLS) * sizeof(uint16_t));
 		for (i = CRT_SIZE - CRT_COLS; i < CRT_SIZE; i++)
-			crt_buf[i] = 0x0700 | ' ';
+			crt_shadow[i] = 0x0700 | ' ';
 		crt_pos -= CRT_COLS;
+		cga_dirty(0, CRT_SIZE);
+	}
+}
+
+// Copy the changed part of the shadow to the screen and move the
+// cursor.
+static void
+cga_flush(void)
+{
+	if (crt_dirty_lo < crt_dirty_hi) {
+		memmove(crt_buf + crt_dirty_lo, crt_shadow + crt_dirty_lo,
+			(crt_dirty_hi - crt_dirty_lo) * sizeof(uint16_t));
+		crt_dirty_lo = CRT_SIZE;
+		crt_dirty_hi = 0;
 	}
 
 	/* move that little blinky thing */
-	outb(addr_6845, 14);
-	outb(addr_6845 + 1, crt_pos >> 8);
-	outb(addr_6845, 15);
-	outb(addr_6845 + 1, crt_pos);
+	if (crt_cursor != crt_pos) {
+		outb(addr_6845, 14);
+		outb(addr_6845 + 1, crt_pos >> 8);
+		outb(addr_6845, 15);
+		outb(addr_6845 + 1, crt_pos);
+		crt_cursor = crt_pos;
+	}
 }
 
 
@@ -359,7 +431,7 @@ kbd_proc_data(void)
 	// Process special keys
 	// Ctrl-Alt-Del: reboot
 	if (!(~shift & (CTL | ALT)) && c == KEY_DEL) {
-		cprintf("Rebooting!\n");
+		cons_puts("Rebooting!\n");
 		outb(0x92, 0x3); // courtesy of Chris Frost
 	}
 
@@ -382,10 +454,147 @@ kbd_init(void)
 
 
 
+/***** Console output buffer *****/
+// Output for the serial and parallel ports is copied into a ring and
+// sent as the devices become ready, mostly from the serial
+// transmitter-empty interrupt, so that printing doesn't hold the big
+// kernel lock while spinning at UART speed.  The parallel port has no
+// usable interrupt; it takes what it can whenever the serial port
+// does, and just loses output if it falls a whole ring behind.
+//
+// Until cons_buffer(1) is called, and after cons_buffer(0), output is
+// written out synchronously instead.
+
+#define CONSOUTSIZE 4096
+
+static struct {
+	uint8_t buf[CONSOUTSIZE];
+	uint32_t rpos;		// Next byte for the serial port
+	uint32_t lpt_rpos;	// Next byte for the parallel port
+	uint32_t wpos;
+} cons_out;
+
+static bool cons_buffered;
+
+// Send buffered output while the transmitter can take it, and ask for
+// an interrupt when it can take more if any is left.
+static void
+serial_tx(void)
+{
+	int n;
+
+	if (!serial_exists) {
+		cons_out.rpos = cons_out.wpos;
+		return;
+	}
+	while (cons_out.rpos != cons_out.wpos
+	       && (inb(COM1 + COM_LSR) & COM_LSR_TXRDY))
+		for (n = 0; n < serial_fifo && cons_out.rpos != cons_out.wpos; n++)
+			outb(COM1 + COM_TX,
+			     cons_out.buf[cons_out.rpos++ % CONSOUTSIZE]);
+	if (cons_out.rpos != cons_out.wpos && cons_buffered)
+		serial_set_ier(COM_IER_RDI | COM_IER_TEI);
+	else
+		serial_set_ier(COM_IER_RDI);
+}
+
+static void
+lpt_tx(void)
+{
+	while (cons_out.lpt_rpos != cons_out.wpos && (inb(0x378+1) & 0x80)) {
+		outb(0x378+0, cons_out.buf[cons_out.lpt_rpos++ % CONSOUTSIZE]);
+		outb(0x378+2, 0x08|0x04|0x01);
+		outb(0x378+2, 0x08);
+	}
+}
+
+// Write out all buffered output, waiting for the devices as needed.
+static void
+cons_flush(void)
+{
+	while (cons_out.rpos != cons_out.wpos)
+		serial_putc(cons_out.buf[cons_out.rpos++ % CONSOUTSIZE]);
+	while (cons_out.lpt_rpos != cons_out.wpos)
+		lpt_putc(cons_out.buf[cons_out.lpt_rpos++ % CONSOUTSIZE]);
+	serial_set_ier(COM_IER_RDI);
+}
+
+// Turn output buffering on or off.  Turning it off (e.g. on panic)
+// first writes out everything buffered.
+void
+cons_buffer(bool on)
+{
+	cons_lock();
+	if (!on)
+		cons_flush();
+	cons_buffered = on;
+	cons_unlock();
+}
+
+// Append up to 'n' bytes to the ring, one memmove per contiguous
+// stretch of free space, and start sending them.  If the ring fills
+// up and 'wait' is set, make room the slow way, by writing out the
+// oldest bytes synchronously; otherwise stop there.
+// Returns the number of bytes appended.
+static size_t
+cons_out_write(const char *s, size_t n, bool wait)
+{
+	size_t done = 0, space, chunk;
+
+	while (done < n) {
+		if (cons_out.wpos - cons_out.rpos == CONSOUTSIZE)
+			serial_tx();
+		space = CONSOUTSIZE - (cons_out.wpos - cons_out.rpos);
+		if (space == 0) {
+			if (!wait)
+				break;
+			serial_putc(cons_out.buf[cons_out.rpos++ % CONSOUTSIZE]);
+			continue;
+		}
+		chunk = MIN(n - done, space);
+		chunk = MIN(chunk, CONSOUTSIZE - cons_out.wpos % CONSOUTSIZE);
+		memmove(cons_out.buf + cons_out.wpos % CONSOUTSIZE, s + done,
+			chunk);
+		cons_out.wpos += chunk;
+		done += chunk;
+		if (cons_out.wpos - cons_out.lpt_rpos > CONSOUTSIZE)
+			cons_out.lpt_rpos = cons_out.wpos - CONSOUTSIZE;
+	}
+
+	if (cons_buffered) {
+		serial_tx();
+		lpt_tx();
+	} else
+		cons_flush();
+	return done;
+}
+
+
 /***** General device-independent console code *****/
 // Here we manage the console input buffer,
 // where we stash characters received from the keyboard or serial port
 // whenever the corresponding interrupt occurs.
+//
+// All console state is protected by console_lock rather than the big
+// kernel lock, so that any CPU can print.  After a panic the lock is
+// ignored, since a CPU that will never release it may hold it.
+
+static struct spinlock console_lock;
+static bool cons_panicked;
+
+static void
+cons_lock(void)
+{
+	if (!cons_panicked)
+		spin_lock(&console_lock);
+}
+
+static void
+cons_unlock(void)
+{
+	if (!cons_panicked)
+		spin_unlock(&console_lock);
+}
 
 #define CONSBUFSIZE 512
 
@@ -417,35 +626,91 @@ cons_getc(void)
 {
 	int c;
 
+	// Whoever wants input should see any prompt first.
+	cprintf_flush();
+
+	cons_lock();
 	// poll for any pending input characters,
 	// so that this function works even when interrupts are disabled
 	// (e.g., when called from the kernel monitor).
-	serial_intr();
+	serial_poll();
 	kbd_intr();
 
 	// grab the next character from the input buffer.
+	c = 0;
 	if (cons.rpos != cons.wpos) {
 		c = cons.buf[cons.rpos++];
 		if (cons.rpos == CONSBUFSIZE)
 			cons.rpos = 0;
-		return c;
 	}
-	return 0;
+	cons_unlock();
+	return c;
 }
 
 // output a character to the console
 static void
 cons_putc(int c)
 {
-	serial_putc(c);
-	lpt_putc(c);
+	char ch = c;
+
+	cons_out_write(&ch, 1, 1);
 	cga_putc(c);
 }
 
+static void
+cons_puts(const char *s)
+{
+	while (*s)
+		cons_putc(*s++);
+	cga_flush();
+}
+
+// Output 'n' characters to the console as a unit.
+void
+cons_write(const char *s, size_t n)
+{
+	size_t i;
+
+	cons_lock();
+	cons_out_write(s, n, 1);
+	for (i = 0; i < n; i++)
+		cga_putc(s[i]);
+	cga_flush();
+	cons_unlock();
+}
+
+// Like cons_write, but only queue as many characters as there is room
+// for without waiting for the serial port.
+// Returns the number of characters output.
+size_t
+cons_write_nowait(const char *s, size_t n)
+{
+	size_t i;
+
+	cons_lock();
+	n = cons_out_write(s, n, 0);
+	for (i = 0; i < n; i++)
+		cga_putc(s[i]);
+	cga_flush();
+	cons_unlock();
+	return n;
+}
+
+// Called on panic: stop buffering and locking, and write out
+// everything buffered so far.
+void
+cons_panic(void)
+{
+	cons_panicked = 1;
+	cprintf_flush();
+	cons_buffer(0);
+}
+
 // initialize the console devices
 void
 cons_init(void)
 {
+	spin_initlock(&console_lock);
 	cga_init();
 	kbd_init();
 	serial_init();
@@ -460,7 +725,11 @@ cons_init(void)
 void
 cputchar(int c)
 {
-	cons_putc(c);
+	char ch = c;
+
+	// Keep order with any partial line cprintf is holding.
+	cprintf_flush();
+	cons_write(&ch, 1);
 }
 
 int
@@ -20,6 +20,14 @@
 void cons_init(void);
 int cons_getc(void);
 
+void cons_write(const char *s, size_t n);
+size_t cons_write_nowait(const char *s, size_t n);
+void cons_buffer(bool on);
+void cons_panic(void);
+
+// In kern/printf.c
+void cprintf_flush(void);
+
 void kbd_intr(void); // irq 1
 void serial_intr(void); // irq 4
 
@@ -22,6 +22,12 @@ struct CpuInfo {
 	uint8_t cpu_id;                 // Local APIC ID; index into cpus[] below
 	volatile unsigned cpu_status;   // The status of the CPU
 	struct Env *cpu_env;            // The currently-running environment.
+	bool cpu_tickless;              // Periodic timer interrupt is off
+	volatile uint32_t cpu_kicked;   // Halted, but sent a T_RESCHED IPI
+	pde_t *cpu_pgdir;               // User page directory loaded in cr3
+	uint64_t cpu_run_start;         // TSC when cpu_env entered user mode
+	uint64_t cpu_trap_start;        // TSC when cpu_env last entered the kernel
+	volatile uint32_t cpu_tlb_pending; // TLB shootdown not yet done
 	struct Taskstate cpu_ts;        // Used by x86 to find stack for interrupt
 };
 
@@ -42,5 +48,9 @@ void lapic_init(void);
 void lapic_startap(uint8_t apicid, uint32_t addr);
 void lapic_eoi(void);
 void lapic_ipi(int vector);
+void lapic_ipi_cpu(int apicid, int vector);
+void lapic_timer_stop(void);
+void lapic_timer_periodic(void);
+void lapic_timer_oneshot(uint32_t nticks);
 
 #endif
@@ -12,6 +12,10 @@ pte_t entry_pgtable[NPTENTRIES];
 // region is critical for a few instructions in entry.S and then we
 // never use it again.
 //
+// The kernel image and the tables boot_alloc hands out right after it
+// can outgrow that first 4MB, so [KERNBASE+4MB, KERNBASE+16MB) is also
+// mapped, using 4MB pages (entry.S and mpentry.S turn on CR4_PSE).
+//
 // Page directories (and page tables), must start on a page boundary,
 // hence the "__aligned__" attribute.  Also, because of restrictions
 // related to linking and static initializers, we use "x + PTE_P"
@@ -24,7 +28,14 @@ pde_t entry_pgdir[NPDENTRIES] = {
 		= ((uintptr_t)entry_pgtable - KERNBASE) + PTE_P,
 	// Map VA's [KERNBASE, KERNBASE+4MB) to PA's [0, 4MB)
 	[KERNBASE>>PDXSHIFT]
-		= ((uintptr_t)entry_pgtable - KERNBASE) + PTE_P + PTE_W
+		= ((uintptr_t)entry_pgtable - KERNBASE) + PTE_P + PTE_W,
+	// Map VA's [KERNBASE+4MB, KERNBASE+16MB) to PA's [4MB, 16MB)
+	[(KERNBASE>>PDXSHIFT) + 1]
+		= 1 * PTSIZE + PTE_P + PTE_W + PTE_PS,
+	[(KERNBASE>>PDXSHIFT) + 2]
+		= 2 * PTSIZE + PTE_P + PTE_W + PTE_PS,
+	[(KERNBASE>>PDXSHIFT) + 3]
+		= 3 * PTSIZE + PTE_P + PTE_W + PTE_PS
 };
 
 // Entry 0 of the page table maps to physical page 0, entry 1 to
@@ -14,6 +14,11 @@
 #include <kern/sched.h>
 #include <kern/cpu.h>
 #include <kern/spinlock.h>
+#include <kern/futex.h>
+#include <kern/port.h>
+#include <kern/time.h>
+#include <kern/trace.h>
+#include <kern/klog.h>
 
 struct Env *envs = NULL;		// All environments
 static struct Env *env_free_list;	// Free environment list
@@ -62,6 +67,51 @@ struct Pseudodesc gdt_pd = {
 	sizeof(gdt) - 1, (unsigned long) gdt
 };
 
+// The live environment of each type with the lowest index in envs[],
+// or 0 if there is none.  This is what ipc_find_env used to find by
+// scanning envs[].
+static envid_t env_type_registry[NENVTYPE];
+
+static void
+env_register(struct Env *e)
+{
+	envid_t *slot = &env_type_registry[e->env_type];
+
+	if (*slot == 0 || ENVX(e->env_id) < ENVX(*slot))
+		*slot = e->env_id;
+}
+
+// Remove 'e' from the registry, promoting the next live env of the
+// same type if there is one.
+static void
+env_unregister(struct Env *e)
+{
+	envid_t *slot = &env_type_registry[e->env_type];
+	int i;
+
+	if (*slot != e->env_id)
+		return;
+	*slot = 0;
+	for (i = 0; i < NENV; i++)
+		if (&envs[i] != e && envs[i].env_status != ENV_FREE
+		    && envs[i].env_type == e->env_type) {
+			*slot = envs[i].env_id;
+			break;
+		}
+}
+
+//
+// Returns the envid of a live environment of type 'type' (the one with
+// the lowest index in envs[]), or 0 if there is none.
+//
+envid_t
+env_lookup_type(enum EnvType type)
+{
+	if ((unsigned) type >= NENVTYPE)
+		return 0;
+	return env_type_registry[type];
+}
+
 //
 // Converts an envid to an env pointer.
 // If checkperm is set, the specified environment must be either the
@@ -230,6 +280,23 @@ env_alloc(struct Env **newenv_store, envid_t parent_id)
 	e->env_type = ENV_TYPE_USER;
 	e->env_status = ENV_RUNNABLE;
 	e->env_runs = 0;
+	e->env_priority = ENV_PRIO_DEFAULT;
+	e->env_nice = 0;
+	e->env_boost = 0;
+	e->env_cycles = 0;
+	e->env_tickets = ENV_TICKETS_DEFAULT;
+	e->env_stride = STRIDE1 / ENV_TICKETS_DEFAULT;
+	e->env_pass = 0;
+	e->env_rq = -1;
+	e->env_cpumask = ~0;
+	e->env_kcycles = 0;
+	e->env_switches = 0;
+	e->env_pgfaults_user = 0;
+	e->env_pgfaults_kernel = 0;
+	e->env_cow_faults = 0;
+	e->env_ipc_sent = 0;
+	e->env_ipc_recvd = 0;
+	memset(e->env_nsyscall, 0, sizeof(e->env_nsyscall));
 	e->senders_count = 0; // Challenge for Lab7
 
 	// Clear out all the saved register state,
@@ -263,11 +330,27 @@ env_alloc(struct Env **newenv_store, envid_t parent_id)
 	// Also clear the IPC receiving flag.
 	e->env_ipc_recving = 0;
 
+	// Not waiting on any futex.
+	e->env_futex_pa = 0;
+	e->env_futex_link = NULL;
+
+	// No timed wait pending.
+	e->env_timeout_armed = 0;
+	e->env_timeout_link = NULL;
+	e->env_timeout_prev = NULL;
+
+	// Not using any port.
+	e->env_ipc_port = 0;
+	e->env_port_recving = 0;
+	e->env_port_sending = 0;
+	e->env_port_link = NULL;
+
 	// commit the allocation
 	env_free_list = e->env_link;
+	env_register(e);
 	*newenv_store = e;
 
-	cprintf("[%08x] new env %08x\n", curenv ? curenv->env_id : 0, e->env_id);
+	klog(KLOG_INFO, "[%08x] new env %08x", curenv ? curenv->env_id : 0, e->env_id);
 	return 0;
 }
 
@@ -378,7 +461,10 @@ env_create(uint8_t *binary, enum EnvType type)
 	struct Env * e;
 	env_alloc(&e, 0);
 	load_icode(e, binary);
+	env_unregister(e);
 	e->env_type = type;
+	env_register(e);
+	sched_enqueue(e);
 }
 
 //
@@ -394,11 +480,19 @@ env_free(struct Env *e)
 	// If freeing the current environment, switch to kern_pgdir
 	// before freeing the page directory, just in case the page
 	// gets reused.
-	if (e == curenv)
+	if (e == curenv) {
+		thiscpu->cpu_pgdir = NULL;
 		lcr3(PADDR(kern_pgdir));
+	}
 
 	// Note the environment's demise.
-	cprintf("[%08x] free env %08x\n", curenv ? curenv->env_id : 0, e->env_id);
+	klog(KLOG_INFO, "[%08x] free env %08x", curenv ? curenv->env_id : 0, e->env_id);
+
+	// Make sure no futex queue still points at e.
+	futex_cancel(e);
+	timeout_cancel(e);
+	port_env_free(e);
+	sched_remove(e);
 
 	// Flush all mapped pages in the user portion of the address space
 	static_assert(UTOP % PTSIZE == 0);
@@ -429,6 +523,7 @@ env_free(struct Env *e)
 	page_decref(pa2page(pa));
 
 	// return the environment to the free list
+	env_unregister(e);
 	e->env_status = ENV_FREE;
 	e->env_link = env_free_list;
 	env_free_list = e;
@@ -444,9 +539,10 @@ env_destroy(struct Env *e)
 {
 	// If e is currently running on other CPUs, we change its state to
 	// ENV_DYING. A zombie environment will be freed the next time
-	// it traps to the kernel.
+	// it traps to the kernel, which we force with a reschedule IPI.
 	if (e->env_status == ENV_RUNNING && curenv != e) {
 		e->env_status = ENV_DYING;
+		sched_kick(&cpus[e->env_cpunum]);
 		return;
 	}
 
@@ -503,14 +599,72 @@ env_run(struct Env *e)
 	//	   registers and drop into user mode in the
 	//	   environment.
 
+	// Charge the time since curenv trapped into the kernel to it.
+	if (curenv)
+		curenv->env_kcycles += read_tsc() - thiscpu->cpu_trap_start;
+
 	if (curenv != e && curenv != NULL 
 			&& curenv->env_status == ENV_RUNNING) {
 			curenv->env_status = ENV_RUNNABLE;
 	}
+	if (curenv != e) {
+		trace_event(TE_RUN, e->env_id, curenv ? curenv->env_id : 0, 0);
+		e->env_switches++;
+	}
 	curenv = e;
 	curenv->env_status = ENV_RUNNING;
 	curenv->env_runs++;
+	thiscpu->cpu_pgdir = e->env_pgdir;
 	lcr3(PADDR(e->env_pgdir));
+	thiscpu->cpu_run_start = read_tsc();
 	unlock_kernel();
 	env_pop_tf(&e->env_tf);
 }
+
+//
+// Print the statistics of every live environment, one per line, or,
+// if envid is nonzero, of that environment alone along with its
+// system call counts by number.
+//
+void
+env_print_stats(envid_t envid)
+{
+	static const char *status[] = {
+		[ENV_FREE] = "free",
+		[ENV_DYING] = "dying",
+		[ENV_RUNNABLE] = "runnable",
+		[ENV_RUNNING] = "running",
+		[ENV_NOT_RUNNABLE] = "blocked",
+	};
+	struct Env *e;
+	uint32_t nsyscall;
+	int i, j;
+
+	if (envid && envid2env(envid, &e, 0) < 0) {
+		cprintf("envstat: no environment %08x\n", envid);
+		return;
+	}
+
+	cprintf("%-8s %-8s %8s %8s %12s %12s %8s %8s %8s %8s %8s %8s\n",
+		"env", "status", "runs", "switches", "ucycles", "kcycles",
+		"syscalls", "ufaults", "kfaults", "cow", "ipcsent", "ipcrecv");
+	for (i = 0; i < NENV; i++) {
+		e = &envs[i];
+		if (e->env_status == ENV_FREE || (envid && e->env_id != envid))
+			continue;
+		nsyscall = 0;
+		for (j = 0; j < NSYSCALLS; j++)
+			nsyscall += e->env_nsyscall[j];
+		cprintf("%08x %-8s %8u %8u %12llu %12llu "
+			"%8u %8u %8u %8u %8u %8u\n",
+			e->env_id, status[e->env_status], e->env_runs,
+			e->env_switches, e->env_cycles, e->env_kcycles,
+			nsyscall, e->env_pgfaults_user, e->env_pgfaults_kernel,
+			e->env_cow_faults, e->env_ipc_sent, e->env_ipc_recvd);
+		if (!envid)
+			continue;
+		for (j = 0; j < NSYSCALLS; j++)
+			if (e->env_nsyscall[j])
+				cprintf("  syscall %2d: %u\n", j, e->env_nsyscall[j]);
+	}
+}
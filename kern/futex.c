@@ -0,0 +1,153 @@
+// Futex-style wait queues keyed by physical address.
+//
+// Environments that share a page (sfork'd children, PTE_SHARE mappings)
+// may map it at different virtual addresses, so waiters are identified
+// by the physical address of the word they are waiting on.  Waiters
+// hash into a fixed table of FIFO queues linked through struct Env.
+
+#include <inc/mmu.h>
+#include <inc/error.h>
+#include <inc/assert.h>
+
+#include <kern/env.h>
+#include <kern/pmap.h>
+#include <kern/sched.h>
+#include <kern/futex.h>
+
+#define NFUTEXHASH	64
+
+static struct {
+	struct Env *head;
+	struct Env *tail;
+} futex_queues[NFUTEXHASH];
+
+static unsigned
+futex_hash(physaddr_t pa)
+{
+	return (pa >> 2) % NFUTEXHASH;
+}
+
+// Translate the user address 'va' in e's address space into the
+// physical address of the futex word.
+// Returns 0 on success, < 0 on error.  Errors are:
+//	-E_INVAL if va >= UTOP or va is not 4-byte aligned.
+//	-E_FAULT if va is not mapped user-readable.
+static int
+futex_lookup(struct Env *e, uint32_t *va, physaddr_t *pa_store)
+{
+	pte_t *pte;
+
+	if ((uintptr_t) va >= UTOP || (uintptr_t) va % sizeof(uint32_t) != 0)
+		return -E_INVAL;
+	pte = pgdir_walk(e->env_pgdir, va, 0);
+	if (!pte || (*pte & (PTE_P | PTE_U)) != (PTE_P | PTE_U))
+		return -E_FAULT;
+	*pa_store = PTE_ADDR(*pte) | PGOFF(va);
+	return 0;
+}
+
+//
+// Block environment 'e' (which must be curenv) on the word at 'va'
+// if it still contains 'expected'.  The value check and the enqueue
+// happen under the kernel lock, so a wakeup between the user's check
+// and this call cannot be lost.
+//
+// On success this does not return; the environment is resumed with 0
+// from the system call once another environment calls futex_wake.
+// Returns < 0 on error.  Errors are:
+//	-E_INVAL, -E_FAULT as for futex_lookup.
+//	-E_WOULD_BLOCK if *va != expected.
+//
+int
+futex_wait(struct Env *e, uint32_t *va, uint32_t expected)
+{
+	physaddr_t pa;
+	unsigned h;
+	int r;
+
+	assert(e == curenv);
+	if ((r = futex_lookup(e, va, &pa)) < 0)
+		return r;
+	// The environment's page directory is loaded, so read directly.
+	if (*(volatile uint32_t *) va != expected)
+		return -E_WOULD_BLOCK;
+
+	h = futex_hash(pa);
+	e->env_futex_pa = pa;
+	e->env_futex_link = NULL;
+	if (futex_queues[h].tail)
+		futex_queues[h].tail->env_futex_link = e;
+	else
+		futex_queues[h].head = e;
+	futex_queues[h].tail = e;
+
+	e->env_tf.tf_regs.reg_eax = 0;
+	e->env_status = ENV_NOT_RUNNABLE;
+	sched_yield();
+}
+
+//
+// Wake up to 'n' environments waiting on the word at 'va' in e's
+// address space, in the order they started waiting.
+// Returns the number of environments woken, or < 0 on error (see
+// futex_lookup).
+//
+int
+futex_wake(struct Env *e, uint32_t *va, int n)
+{
+	physaddr_t pa;
+	struct Env **pp, *w, *prev;
+	unsigned h;
+	int r, woken;
+
+	if ((r = futex_lookup(e, va, &pa)) < 0)
+		return r;
+
+	h = futex_hash(pa);
+	woken = 0;
+	prev = NULL;
+	pp = &futex_queues[h].head;
+	while ((w = *pp) && woken < n) {
+		if (w->env_futex_pa != pa) {
+			prev = w;
+			pp = &w->env_futex_link;
+			continue;
+		}
+		*pp = w->env_futex_link;
+		if (futex_queues[h].tail == w)
+			futex_queues[h].tail = prev;
+		w->env_futex_pa = 0;
+		w->env_futex_link = NULL;
+		sched_wakeup(w);
+		woken++;
+	}
+	return woken;
+}
+
+//
+// Remove 'e' from whatever futex queue it is waiting on, if any.
+// Called when an environment is freed.
+//
+void
+futex_cancel(struct Env *e)
+{
+	struct Env **pp, *prev;
+	unsigned h;
+
+	if (!e->env_futex_pa)
+		return;
+
+	h = futex_hash(e->env_futex_pa);
+	prev = NULL;
+	for (pp = &futex_queues[h].head; *pp; pp = &(*pp)->env_futex_link) {
+		if (*pp == e) {
+			*pp = e->env_futex_link;
+			if (futex_queues[h].tail == e)
+				futex_queues[h].tail = prev;
+			break;
+		}
+		prev = *pp;
+	}
+	e->env_futex_pa = 0;
+	e->env_futex_link = NULL;
+}
@@ -0,0 +1,17 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_KERN_FUTEX_H
+#define JOS_KERN_FUTEX_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+struct Env;
+
+int	futex_wait(struct Env *e, uint32_t *va, uint32_t expected);
+int	futex_wake(struct Env *e, uint32_t *va, int n);
+void	futex_cancel(struct Env *e);
+
+#endif	// !JOS_KERN_FUTEX_H
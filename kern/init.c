@@ -3,6 +3,7 @@
 #include <inc/stdio.h>
 #include <inc/string.h>
 #include <inc/assert.h>
+#include <inc/x86.h>
 
 #include <kern/monitor.h>
 #include <kern/console.h>
@@ -14,38 +15,56 @@
 #include <kern/picirq.h>
 #include <kern/cpu.h>
 #include <kern/spinlock.h>
+#include <kern/time.h>
+#include <kern/port.h>
+#include <kern/klog.h>
 
 static void boot_aps(void);
+static void boot_phase(const char *name);
+static void boot_report(void);
 
 
 void
 i386_init(void)
 {
+	boot_phase(NULL);
+
 	// Initialize the console.
 	// Can't call cprintf until after we do this!
 	cons_init();
+	boot_phase("cons_init");
 
 	cprintf("6828 decimal is %o octal!\n", 6828);
 
 	// Lab 2 memory management initialization functions
 	mem_init();
+	boot_phase("mem_init");
 
 	// Lab 3 user environment initialization functions
 	env_init();
+	boot_phase("env_init");
+	port_init();
 	trap_init();
+	boot_phase("trap_init");
 
 	// Lab 4 multiprocessor initialization functions
 	mp_init();
 	lapic_init();
+	boot_phase("mp_init");
 
 	// Lab 4 multitasking initialization functions
 	pic_init();
 
+	// Kernel tick counter and timeouts
+	time_init();
+	boot_phase("time_init");
+
 	// Acquire the big kernel lock before waking up APs
 	// Your code here:
 	lock_kernel();
 	// Starting non-boot CPUs
 	boot_aps();
+	boot_phase("boot_aps");
 
 #if defined(TEST)
 	// Don't touch -- used by grading script!
@@ -56,11 +75,64 @@ i386_init(void)
 	ENV_CREATE(user_yield, ENV_TYPE_USER);
 	ENV_CREATE(user_yield, ENV_TYPE_USER);
 #endif // TEST*
+	boot_phase("env_create");
+	boot_report();
+
+	// From here on, console output is sent by the serial interrupt.
+	cons_buffer(1);
 
 	// Schedule and run the first user environment!
 	sched_yield();
 }
 
+// Boot timing.  boot_phase records the TSC as each phase of i386_init
+// ends, and boot_aps and mp_main time each AP's startup; boot_report
+// logs the lot once time_init has calibrated the TSC.
+#define NBOOTPHASE	16
+
+static struct {
+	const char *name;
+	uint64_t tsc;
+} boot_phases[NBOOTPHASE];
+static int nboot_phases;
+static uint64_t ap_start_cycles[NCPU];	// lapic_startap to CPU_STARTED
+static uint64_t ap_setup_cycles[NCPU];	// Spent in mp_main
+
+static void
+boot_phase(const char *name)
+{
+	if (nboot_phases == NBOOTPHASE)
+		return;
+	boot_phases[nboot_phases].name = name;
+	boot_phases[nboot_phases].tsc = read_tsc();
+	nboot_phases++;
+}
+
+static void
+boot_report(void)
+{
+	uint64_t cycles;
+	int i;
+
+	// The TSC starts at reset, so the first phase ends when the BIOS
+	// and the boot loader hand over to i386_init.
+	klog(KLOG_INFO, "boot: %-10s %12llu cycles %8llu us", "loader",
+	     boot_phases[0].tsc, time_tsc_to_ns(boot_phases[0].tsc) / 1000);
+	for (i = 1; i < nboot_phases; i++) {
+		cycles = boot_phases[i].tsc - boot_phases[i - 1].tsc;
+		klog(KLOG_INFO, "boot: %-10s %12llu cycles %8llu us",
+		     boot_phases[i].name, cycles, time_tsc_to_ns(cycles) / 1000);
+	}
+	for (i = 0; i < ncpu; i++)
+		if (ap_start_cycles[i])
+			klog(KLOG_INFO, "boot:   cpu %d started in %llu cycles"
+			     " (%llu in mp_main)", i, ap_start_cycles[i],
+			     ap_setup_cycles[i]);
+	cycles = boot_phases[nboot_phases - 1].tsc - boot_phases[0].tsc;
+	klog(KLOG_INFO, "boot: %-10s %12llu cycles %8llu us", "kernel",
+	     cycles, time_tsc_to_ns(cycles) / 1000);
+}
+
 // While boot_aps is booting a given CPU, it communicates the per-core
 // stack pointer that should be loaded by mpentry.S to that CPU in
 // this variable.
@@ -73,6 +145,7 @@ boot_aps(void)
 	extern unsigned char mpentry_start[], mpentry_end[];
 	void *code;
 	struct CpuInfo *c;
+	uint64_t start;
 
 	// Write entry code to unused memory at MPENTRY_PADDR
 	code = KADDR(MPENTRY_PADDR);
@@ -86,10 +159,12 @@ boot_aps(void)
 		// Tell mpentry.S what stack to use 
 		mpentry_kstack = percpu_kstacks[c - cpus] + KSTKSIZE;
 		// Start the CPU at mpentry_start
+		start = read_tsc();
 		lapic_startap(c->cpu_id, PADDR(code));
 		// Wait for the CPU to finish some basic setup in mp_main()
 		while(c->cpu_status != CPU_STARTED)
 			;
+		ap_start_cycles[c - cpus] = read_tsc() - start;
 	}
 }
 
@@ -97,6 +172,8 @@ boot_aps(void)
 void
 mp_main(void)
 {
+	uint64_t start = read_tsc();
+
 	// We are in high EIP now, safe to switch to kern_pgdir 
 	lcr3(PADDR(kern_pgdir));
 	cprintf("SMP: CPU %d starting\n", cpunum());
@@ -104,6 +181,7 @@ mp_main(void)
 	lapic_init();
 	env_init_percpu();
 	trap_init_percpu();
+	ap_setup_cycles[cpunum()] = read_tsc() - start;
 	xchg(&thiscpu->cpu_status, CPU_STARTED); // tell boot_aps() we're up
 
 	// Now that we have finished some basic setup, call sched_yield()
@@ -137,6 +215,10 @@ _panic(const char *file, int line, const char *fmt,...)
 	// Be extra sure that the machine is in as reasonable state
 	asm volatile("cli; cld");
 
+	// Nobody may be around to take the serial interrupt, or to
+	// release the console lock.
+	cons_panic();
+
 	va_start(ap, fmt);
 	cprintf("kernel panic on CPU %d at %s:%d: ", cpunum(), file, line);
 	vcprintf(fmt, ap);
@@ -1,6 +1,7 @@
 /* See COPYRIGHT for copyright information. */
 
-/* Support for reading the NVRAM from the real-time clock. */
+/* Support for reading the NVRAM from the real-time clock,
+ * and for timing short intervals with the PIT. */
 
 #include <inc/x86.h>
 
@@ -20,3 +21,28 @@ mc146818_write(unsigned reg, unsigned datum)
 	outb(IO_RTC, reg);
 	outb(IO_RTC+1, datum);
 }
+
+/*
+ * Start PIT channel 2 counting down 'usec' microseconds (at most about
+ * 54ms).  Channel 2 is used because its gate and output can be read
+ * back through port 0x61 without taking an interrupt.
+ */
+void
+pit_oneshot_start(unsigned usec)
+{
+	unsigned count = (unsigned long long) PIT_HZ * usec / 1000000;
+
+	/* Gate high, speaker off */
+	outb(IO_PIT_GATE, (inb(IO_PIT_GATE) & ~0x02) | 0x01);
+	/* Channel 2, lobyte/hibyte, mode 0 (interrupt on terminal count) */
+	outb(IO_PIT + 3, 0xb0);
+	outb(IO_PIT + 2, count & 0xff);
+	outb(IO_PIT + 2, count >> 8);
+}
+
+/* Has the interval started by pit_oneshot_start elapsed? */
+int
+pit_oneshot_done(void)
+{
+	return (inb(IO_PIT_GATE) & 0x20) != 0;
+}
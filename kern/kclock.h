@@ -26,4 +26,12 @@
 unsigned mc146818_read(unsigned reg);
 void mc146818_write(unsigned reg, unsigned datum);
 
+/* 8253/8254 programmable interval timer, channel 2 */
+#define	IO_PIT		0x040		/* PIT ports 0x40-0x43 */
+#define	PIT_HZ		1193182		/* PIT input clock */
+#define	IO_PIT_GATE	0x061		/* Channel 2 gate and output */
+
+void pit_oneshot_start(unsigned usec);
+int pit_oneshot_done(void);
+
 #endif	// !JOS_KERN_KCLOCK_H
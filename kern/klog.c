@@ -0,0 +1,92 @@
+// The kernel log: a ring of recent kernel messages, each with a level
+// and a timestamp, that user environments can read at ULOG.  Only
+// messages up to klogbuf->kl_console also go to the (slow) console.
+
+#include <inc/stdio.h>
+#include <inc/stdarg.h>
+#include <inc/error.h>
+#include <inc/assert.h>
+#include <inc/string.h>
+
+#include <kern/cpu.h>
+#include <kern/klog.h>
+#include <kern/spinlock.h>
+#include <kern/time.h>
+
+struct KLog *klogbuf;
+
+static struct spinlock klog_lock = {
+#ifdef DEBUG_SPINLOCK
+	.name = "klog_lock"
+#endif
+};
+
+// Log a message at 'level', and print it if the console wants it.
+// A trailing newline in the message is optional.
+void
+klog(int level, const char *fmt, ...)
+{
+	struct KLogRecord *kr;
+	char text[KLOG_TEXTLEN];
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(text, sizeof(text), fmt, ap);
+	va_end(ap);
+	len = MIN(len, KLOG_TEXTLEN - 1);
+	if (len > 0 && text[len - 1] == '\n')
+		len--;
+
+	if (!klogbuf) {
+		cprintf("%.*s\n", len, text);
+		return;
+	}
+
+	spin_lock(&klog_lock);
+	kr = &klogbuf->kl_rec[klogbuf->kl_next % KLOG_NREC];
+	// Readers check kr_seq before and after copying the record.
+	kr->kr_seq = 0;
+	kr->kr_ns = time_ns();
+	kr->kr_level = level;
+	kr->kr_cpu = cpunum();
+	kr->kr_len = len;
+	memmove(kr->kr_text, text, len);
+	kr->kr_seq = klogbuf->kl_next++;
+	spin_unlock(&klog_lock);
+
+	if (level <= klogbuf->kl_console)
+		cprintf("%.*s\n", len, text);
+}
+
+// Print messages up to 'level' on the console, and return the old
+// console level, or -E_INVAL if level is not a valid level.
+int
+klog_set_console(int level)
+{
+	int old = klogbuf->kl_console;
+
+	if (level < KLOG_ERR || level >= NKLOGLEVEL)
+		return -E_INVAL;
+	klogbuf->kl_console = level;
+	return old;
+}
+
+// Print the whole log on the console, like dmesg.
+void
+klog_dump(void)
+{
+	struct KLogRecord *kr;
+	uint32_t seq;
+	uint64_t us;
+
+	spin_lock(&klog_lock);
+	seq = klogbuf->kl_next > KLOG_NREC ? klogbuf->kl_next - KLOG_NREC : 1;
+	for (; seq < klogbuf->kl_next; seq++) {
+		kr = &klogbuf->kl_rec[seq % KLOG_NREC];
+		us = kr->kr_ns / 1000;
+		cprintf("[%5u.%06u] %.*s\n", (uint32_t) (us / 1000000),
+			(uint32_t) (us % 1000000), kr->kr_len, kr->kr_text);
+	}
+	spin_unlock(&klog_lock);
+}
@@ -0,0 +1,25 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_KERN_KLOG_H
+#define JOS_KERN_KLOG_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/klog.h>
+
+// Messages up to this level are printed on the console as well as
+// logged, until changed at run time.  Override at build time with
+// e.g. 'make KLOG_CONSOLE=1' to keep env lifecycle messages
+// (KLOG_INFO) off the console.
+#ifndef KLOG_CONSOLE
+#define KLOG_CONSOLE	KLOG_INFO
+#endif
+
+extern struct KLog *klogbuf;	// Allocated by mem_init, mapped at ULOG
+
+void	klog(int level, const char *fmt, ...);
+int	klog_set_console(int level);
+void	klog_dump(void);
+
+#endif	// !JOS_KERN_KLOG_H
@@ -9,6 +9,8 @@
 #include <inc/x86.h>
 #include <kern/pmap.h>
 #include <kern/cpu.h>
+#include <kern/kclock.h>
+#include <kern/time.h>
 
 // Local APIC registers, divided by 4 for use as uint32_t[] indices.
 #define ID      (0x0020/4)   // ID
@@ -45,6 +47,12 @@
 physaddr_t lapicaddr;        // Initialized in mpconfig.c
 volatile uint32_t *lapic;
 
+// Length of the calibration interval.
+#define CALIBRATE_USEC	10000
+
+static uint32_t lapic_timer_hz; // LAPIC timer counts per second
+static uint32_t lapic_ticr;  // Initial count giving HZ interrupts/sec
+
 static void
 lapicw(int index, int value)
 {
@@ -52,6 +60,37 @@ lapicw(int index, int value)
 	lapic[ID];  // wait for write to finish, by reading
 }
 
+// Measure the LAPIC timer and TSC rates against the PIT, which runs
+// at a known frequency, so the tick length does not depend on the
+// (possibly emulated) bus clock.  All CPUs share the boot CPU's result.
+static void
+lapic_calibrate(void)
+{
+	uint32_t elapsed;
+	uint64_t tsc0, tsc1;
+
+	lapicw(TDCR, X1);
+	lapicw(TIMER, MASKED);
+	pit_oneshot_start(CALIBRATE_USEC);
+	lapicw(TICR, 0xFFFFFFFF);
+	tsc0 = read_tsc();
+	while (!pit_oneshot_done())
+		;
+	elapsed = 0xFFFFFFFF - lapic[TCCR];
+	tsc1 = read_tsc();
+	lapicw(TICR, 0);
+
+	lapic_timer_hz = elapsed * (1000000 / CALIBRATE_USEC);
+	tsc_hz = (tsc1 - tsc0) * (1000000 / CALIBRATE_USEC);
+	lapic_ticr = lapic_timer_hz / HZ;
+	if (lapic_ticr == 0) {
+		cprintf("lapic: timer calibration failed\n");
+		lapic_ticr = 10000000;
+	}
+	cprintf("lapic: timer %u kHz, TSC %u MHz, HZ %d\n",
+		lapic_timer_hz / 1000, (uint32_t) (tsc_hz / 1000000), HZ);
+}
+
 void
 lapic_init(void)
 {
@@ -66,12 +105,14 @@ lapic_init(void)
 	lapicw(SVR, ENABLE | (IRQ_OFFSET + IRQ_SPURIOUS));
 
 	// The timer repeatedly counts down at bus frequency
-	// from lapic[TICR] and then issues an interrupt.  
-	// If we cared more about precise timekeeping,
-	// TICR would be calibrated using an external time source.
+	// from lapic[TICR] and then issues an interrupt.
+	// TICR is calibrated on the boot CPU so that this
+	// happens HZ times per second.
+	if (thiscpu == bootcpu)
+		lapic_calibrate();
 	lapicw(TDCR, X1);
 	lapicw(TIMER, PERIODIC | (IRQ_OFFSET + IRQ_TIMER));
-	lapicw(TICR, 10000000); 
+	lapicw(TICR, lapic_ticr);
 
 	// Leave LINT0 of the BSP enabled so that it can get
 	// interrupts from the 8259A chip.
@@ -127,14 +168,16 @@ lapic_eoi(void)
 		lapicw(EOI, 0);
 }
 
-// Spin for a given number of microseconds.
-// On real hardware would want to tune this dynamically.
+// Spin for a given number of microseconds, using the TSC rate
+// measured by lapic_calibrate.
 static void
 microdelay(int us)
 {
-}
+	uint64_t end = read_tsc() + tsc_hz * us / 1000000;
 
-#define IO_RTC  0x70
+	while (read_tsc() < end)
+		;
+}
 
 // Start additional processor running entry code at addr.
 // See Appendix B of MultiProcessor Specification.
@@ -173,6 +216,37 @@ lapic_startap(uint8_t apicid, uint32_t addr)
 	}
 }
 
+// Restart the periodic HZ timer interrupt.
+void
+lapic_timer_periodic(void)
+{
+	lapicw(TIMER, PERIODIC | (IRQ_OFFSET + IRQ_TIMER));
+	lapicw(TICR, lapic_ticr);
+}
+
+// Replace the periodic timer interrupt with a single interrupt
+// 'nticks' ticks from now.
+void
+lapic_timer_oneshot(uint32_t nticks)
+{
+	uint64_t count = (uint64_t) nticks * lapic_ticr;
+
+	if (count == 0)
+		count = 1;
+	if (count > 0xFFFFFFFF)
+		count = 0xFFFFFFFF;
+	lapicw(TIMER, IRQ_OFFSET + IRQ_TIMER);
+	lapicw(TICR, count);
+}
+
+// Stop the timer interrupt altogether.
+void
+lapic_timer_stop(void)
+{
+	lapicw(TIMER, MASKED | (IRQ_OFFSET + IRQ_TIMER));
+	lapicw(TICR, 0);
+}
+
 void
 lapic_ipi(int vector)
 {
@@ -180,3 +254,13 @@ lapic_ipi(int vector)
 	while (lapic[ICRLO] & DELIVS)
 		;
 }
+
+// Send interrupt 'vector' to the CPU with local APIC ID 'apicid' only.
+void
+lapic_ipi_cpu(int apicid, int vector)
+{
+	lapicw(ICRHI, apicid << 24);
+	lapicw(ICRLO, FIXED | vector);
+	while (lapic[ICRLO] & DELIVS)
+		;
+}
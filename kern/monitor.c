@@ -11,6 +11,11 @@
 #include <kern/monitor.h>
 #include <kern/kdebug.h>
 #include <kern/trap.h>
+#include <kern/env.h>
+#include <kern/prof.h>
+#include <kern/trace.h>
+#include <kern/klog.h>
+#include <kern/syslat.h>
 
 #define CMDBUF_SIZE	80	// enough for one VGA text line
 
@@ -29,6 +34,12 @@ static struct Command commands[] = {
 	{ "showmappings", "Display physical page mappings", mon_showmappings },
 	{ "setperm", "Set the permission bits of a page mapping", mon_setperm },
 	{ "clearperm", "Clear the permission bits of a page mapping", mon_clearperm },
+	{ "prof", "Profiler: prof on|off, or prof [n] to show n hot spots", mon_prof },
+	{ "trace", "Event trace: trace on|off|dump", mon_trace },
+	{ "dmesg", "Display the kernel log", mon_dmesg },
+	{ "loglevel", "Set the highest log level printed on the console", mon_loglevel },
+	{ "envstat", "Display environment statistics: envstat [envid]", mon_envstat },
+	{ "syslat", "Syscall latency: syslat on|off, or syslat [syscallno]", mon_syslat },
 };
 
 /***** Implementations of basic kernel monitor commands *****/
@@ -163,6 +174,69 @@ mon_clearperm(int argc, char **argv, struct Trapframe *tf)
 	
 }
 
+// Start or stop the sampling profiler, or show where the samples
+// taken so far landed.
+int
+mon_prof(int argc, char **argv, struct Trapframe *tf)
+{
+	if (argc > 1 && strcmp(argv[1], "on") == 0)
+		prof_start();
+	else if (argc > 1 && strcmp(argv[1], "off") == 0)
+		prof_stop();
+	else
+		prof_report(argc > 1 ? strtol(argv[1], NULL, 0) : 20);
+	return 0;
+}
+
+// Start or stop event tracing, or dump the trace buffers.
+int
+mon_trace(int argc, char **argv, struct Trapframe *tf)
+{
+	if (argc == 2 && strcmp(argv[1], "on") == 0)
+		trace_start();
+	else if (argc == 2 && strcmp(argv[1], "off") == 0)
+		trace_stop();
+	else if (argc == 2 && strcmp(argv[1], "dump") == 0)
+		trace_dump();
+	else
+		cprintf("usage: trace on|off|dump\n");
+	return 0;
+}
+
+int
+mon_dmesg(int argc, char **argv, struct Trapframe *tf)
+{
+	klog_dump();
+	return 0;
+}
+
+int
+mon_loglevel(int argc, char **argv, struct Trapframe *tf)
+{
+	if (argc != 2 || klog_set_console(strtol(argv[1], NULL, 0)) < 0)
+		cprintf("usage: loglevel 0-%d\n", NKLOGLEVEL - 1);
+	return 0;
+}
+
+int
+mon_envstat(int argc, char **argv, struct Trapframe *tf)
+{
+	env_print_stats(argc > 1 ? strtol(argv[1], NULL, 16) : 0);
+	return 0;
+}
+
+int
+mon_syslat(int argc, char **argv, struct Trapframe *tf)
+{
+	if (argc > 1 && strcmp(argv[1], "on") == 0)
+		syslat_start();
+	else if (argc > 1 && strcmp(argv[1], "off") == 0)
+		syslat_stop();
+	else
+		syslat_report(argc > 1 ? strtol(argv[1], NULL, 0) : -1);
+	return 0;
+}
+
 /***** Kernel monitor command interpreter *****/
 
 #define WHITESPACE "\t\r\n "
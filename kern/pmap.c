@@ -10,6 +10,7 @@
 #include <kern/kclock.h>
 #include <kern/env.h>
 #include <kern/cpu.h>
+#include <kern/klog.h>
 
 // These variables are set by i386_detect_memory()
 size_t npages;			// Amount of physical memory (in pages)
@@ -103,8 +104,12 @@ boot_alloc(uint32_t n)
 	// Allocate a chunk large enough to hold 'n' bytes, then update
 	// nextfree.  Make sure nextfree is kept aligned
 	// to a multiple of PGSIZE.
+	// entry_pgdir only maps the first 16MB of physical memory.
 	result = nextfree;
 	nextfree += ROUNDUP(n, PGSIZE);
+	if ((uintptr_t) nextfree > KERNBASE + 4 * PTSIZE
+	    || PADDR(nextfree) > npages * PGSIZE)
+		panic("boot_alloc: out of memory allocating %u bytes", n);
 	return result; 
 }
 
@@ -150,6 +155,12 @@ mem_init(void)
 	// Make 'envs' point to an array of size 'NENV' of 'struct Env'.
 	envs = (struct Env *) boot_alloc(NENV*sizeof(struct Env));
 	//////////////////////////////////////////////////////////////////////
+	// Allocate the kernel log.
+	klogbuf = (struct KLog *) boot_alloc(KLOG_SIZE);
+	memset(klogbuf, 0, KLOG_SIZE);
+	klogbuf->kl_next = 1;
+	klogbuf->kl_console = KLOG_CONSOLE;
+	//////////////////////////////////////////////////////////////////////
 	// Now that we've allocated the initial kernel data structures, we set
 	// up the list of free physical pages. Once we've done so, all further
 	// memory management will go through the page_* functions. In
@@ -157,9 +168,11 @@ mem_init(void)
 	// or page_insert
 	page_init();
 
+#ifndef FASTBOOT
 	check_page_free_list(1);
 	check_page_alloc();
 	check_page();
+#endif
 
 	//////////////////////////////////////////////////////////////////////
 	// Now we set up virtual memory
@@ -181,6 +194,10 @@ mem_init(void)
 	boot_map_region(kern_pgdir, UENVS, NENV*sizeof(struct Env), 
 			PADDR(envs), PTE_U | PTE_P);
 	//////////////////////////////////////////////////////////////////////
+	// Map the kernel log read-only by the user at linear address ULOG.
+	boot_map_region(kern_pgdir, ULOG, KLOG_SIZE, PADDR(klogbuf),
+			PTE_U | PTE_P);
+	//////////////////////////////////////////////////////////////////////
 	// Use the physical memory that 'bootstack' refers to as the kernel
 	// stack.  The kernel stack grows down from virtual address KSTACKTOP.
 	// We consider the entire range from [KSTACKTOP-PTSIZE, KSTACKTOP)
@@ -205,8 +222,10 @@ mem_init(void)
 	mem_init_mp();
 
 	boot_map_region(kern_pgdir, KERNBASE, 0x100000000 - KERNBASE, 0, PTE_W | PTE_P);
+#ifndef FASTBOOT
 	// Check that the initial page directory has been set up correctly.
 	check_kern_pgdir();
+#endif
 
 	// Switch from the minimal entry page directory to the full kern_pgdir
 	// page table we just created.	Our instruction pointer should be
@@ -214,7 +233,9 @@ mem_init(void)
 	// mapped the same way by both page tables.
 	lcr3(PADDR(kern_pgdir));
 
+#ifndef FASTBOOT
 	check_page_free_list(0);
+#endif
 
 	// entry.S set the really important flags in cr0 (including enabling
 	// paging).  Here we configure the rest of the flags that we care about.
@@ -223,8 +244,10 @@ mem_init(void)
 	cr0 &= ~(CR0_TS|CR0_EM);
 	lcr0(cr0);
 
+#ifndef FASTBOOT
 	// Some more checks, only possible after kern_pgdir is installed.
 	check_page_installed_pgdir();
+#endif
 }
 
 // Modify mappings in kern_pgdir to support SMP
@@ -275,8 +298,10 @@ page_init(void)
 	size_t i;
 	// mark physical page 0 as in use
 	pages[0].pp_ref = 1;
-	// the rest of base memory is free
-	for (i = 1; i < npages; i++) {
+	// the rest of base memory is free.  Build the free list from the
+	// top down so that the lowest pages, which entry_pgdir maps, are
+	// handed out first while mem_init still runs on it.
+	for (i = npages - 1; i >= 1; i--) {
 		if (page2pa(&pages[i]) == MPENTRY_PADDR) {
 			pages[i].pp_ref = 1;
 			continue;
@@ -491,16 +516,124 @@ page_remove(pde_t *pgdir, void *va)
 	}
 }
 
+// --------------------------------------------------------------
+// TLB shootdown.
+//
+// Each CPU records the user page directory it has loaded in
+// cpu_pgdir.  When mappings in a page directory change, every other
+// CPU that has it loaded gets one T_TLBFLUSH IPI, covering up to
+// TLB_BATCH pages or else the whole TLB, and we wait for all of them
+// to finish before the old pages can be reused.
+//
+// Shootdowns are only started with the big kernel lock held, so one
+// request buffer is enough.  The targets must not need the lock to
+// answer: the IPI handler runs without it, and a CPU spinning for it
+// polls for requests instead (see spin_lock).
+// --------------------------------------------------------------
+
+#define TLB_BATCH	16
+
+static struct {
+	pde_t *pgdir;			// Page directory being changed
+	size_t npages;			// 0 means flush everything
+	uintptr_t va[TLB_BATCH];	// Pages to invalidate
+} tlb_req;
+
+// Carry out this CPU's part of a pending shootdown, if there is one.
+void
+tlb_shootdown_poll(void)
+{
+	struct CpuInfo *c = thiscpu;
+	size_t i;
+
+	if (!c->cpu_tlb_pending)
+		return;
+	if (rcr3() == PADDR(tlb_req.pgdir)) {
+		if (tlb_req.npages == 0)
+			tlbflush();
+		else
+			for (i = 0; i < tlb_req.npages; i++)
+				invlpg((void *) tlb_req.va[i]);
+	}
+	xchg(&c->cpu_tlb_pending, 0);
+}
+
+// Called from the T_TLBFLUSH interrupt stub in trapentry.S.
+void
+tlb_shootdown_intr(void)
+{
+	tlb_shootdown_poll();
+	lapic_eoi();
+}
+
+// Invalidate 'npages' pages starting at 'va' in 'pgdir' on every CPU
+// that has it loaded (all of them if npages is 0 or too many to list).
+static void
+tlb_shootdown(pde_t *pgdir, uintptr_t va, size_t npages)
+{
+	struct CpuInfo *c;
+	size_t i;
+	bool sent = 0;
+
+	// Flush locally if we're modifying the current address space.
+	if (!curenv || curenv->env_pgdir == pgdir) {
+		if (npages == 0 || npages > TLB_BATCH)
+			tlbflush();
+		else
+			for (i = 0; i < npages; i++)
+				invlpg((void *) (va + i * PGSIZE));
+	}
+
+	for (c = cpus; c < cpus + ncpu; c++)
+		if (c != thiscpu && c->cpu_pgdir == pgdir)
+			break;
+	if (c == cpus + ncpu)
+		return;
+
+	tlb_req.pgdir = pgdir;
+	tlb_req.npages = npages > TLB_BATCH ? 0 : npages;
+	for (i = 0; i < tlb_req.npages; i++)
+		tlb_req.va[i] = va + i * PGSIZE;
+	for (c = cpus; c < cpus + ncpu; c++)
+		if (c != thiscpu && c->cpu_pgdir == pgdir) {
+			xchg(&c->cpu_tlb_pending, 1);
+			lapic_ipi_cpu(c->cpu_id, T_TLBFLUSH);
+		}
+	for (c = cpus; c < cpus + ncpu; c++)
+		while (c->cpu_tlb_pending)
+			asm volatile("pause");
+}
+
 //
-// Invalidate a TLB entry, but only if the page tables being
-// edited are the ones currently in use by the processor.
+// Invalidate a TLB entry, on every CPU that is using the page tables
+// being edited.
 //
 void
 tlb_invalidate(pde_t *pgdir, void *va)
 {
-	// Flush the entry only if we're modifying the current address space.
-	if (!curenv || curenv->env_pgdir == pgdir)
-		invlpg(va);
+	tlb_shootdown(pgdir, (uintptr_t) va, 1);
+}
+
+//
+// Invalidate 'npages' consecutive TLB entries starting at 'va', with
+// at most one IPI per CPU.
+//
+void
+tlb_invalidate_range(pde_t *pgdir, void *va, size_t npages)
+{
+	if (npages > 0)
+		tlb_shootdown(pgdir, (uintptr_t) va, npages);
+}
+
+//
+// Flush the whole TLB on every CPU using 'pgdir'.  Cheaper than
+// calling tlb_invalidate() for every page when many mappings change
+// at once.
+//
+void
+tlb_flush_pgdir(pde_t *pgdir)
+{
+	tlb_shootdown(pgdir, 0, 0);
 }
 
 //
@@ -764,6 +897,9 @@ check_kern_pgdir(void)
 	n = ROUNDUP(NENV*sizeof(struct Env), PGSIZE);
 	for (i = 0; i < n; i += PGSIZE)
 		assert(check_va2pa(pgdir, UENVS + i) == PADDR(envs) + i);
+	// check kernel log
+	for (i = 0; i < KLOG_SIZE; i += PGSIZE)
+		assert(check_va2pa(pgdir, ULOG + i) == PADDR(klogbuf) + i);
 
 	// check phys mem
 	for (i = 0; i < npages * PGSIZE; i += PGSIZE)
@@ -788,6 +924,7 @@ check_kern_pgdir(void)
 		case PDX(KSTACKTOP-1):
 		case PDX(UPAGES):
 		case PDX(UENVS):
+		case PDX(ULOG):
 		case PDX(MMIOBASE):
 			assert(pgdir[i] & PTE_P);
 			break;
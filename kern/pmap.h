@@ -62,6 +62,9 @@ struct PageInfo *page_lookup(pde_t *pgdir, void *va, pte_t **pte_store);
 void	page_decref(struct PageInfo *pp);
 
 void	tlb_invalidate(pde_t *pgdir, void *va);
+void	tlb_invalidate_range(pde_t *pgdir, void *va, size_t npages);
+void	tlb_flush_pgdir(pde_t *pgdir);
+void	tlb_shootdown_poll(void);
 
 void *	mmio_map_region(physaddr_t pa, size_t size);
 
@@ -0,0 +1,200 @@
+// IPC ports.
+//
+// A port is owned by the environment that created it, which is the only
+// one that can receive on it.  The owner grants other environments the
+// right to send.  Senders that find the owner not receiving on the port
+// block on the port's own FIFO queue, so the owner can pick which ports
+// it is willing to take messages from.
+
+#include <inc/error.h>
+#include <inc/assert.h>
+
+#include <kern/env.h>
+#include <kern/port.h>
+#include <kern/sched.h>
+
+static struct Port ports[NPORT];
+static struct Port *port_free_list;
+
+void
+port_init(void)
+{
+	int i;
+
+	port_free_list = NULL;
+	for (i = NPORT - 1; i >= 0; i--) {
+		ports[i].port_id = 0;
+		ports[i].port_owner = 0;
+		ports[i].port_link = port_free_list;
+		port_free_list = &ports[i];
+	}
+}
+
+//
+// Allocate a port owned by 'owner' with the given priority.
+//
+// Returns 0 on success, < 0 on failure.  Errors include:
+//	-E_NO_FREE_PORT if all NPORT ports are allocated
+//
+int
+port_alloc(struct Port **port_store, struct Env *owner, int priority)
+{
+	struct Port *p;
+	int32_t generation;
+	int i;
+
+	if (!(p = port_free_list))
+		return -E_NO_FREE_PORT;
+
+	generation = (p->port_id + (1 << LOG2NPORT)) & ~(NPORT - 1);
+	if (generation <= 0)
+		generation = 1 << LOG2NPORT;
+	p->port_id = generation | (p - ports);
+	p->port_owner = owner->env_id;
+	p->port_priority = priority;
+	for (i = 0; i < NPORTGRANT; i++)
+		p->port_grants[i] = 0;
+	p->port_public = 0;
+	p->port_head = p->port_tail = NULL;
+
+	port_free_list = p->port_link;
+	*port_store = p;
+	return 0;
+}
+
+//
+// Free port 'p'.  Any senders still blocked on it fail with -E_BAD_PORT.
+//
+void
+port_free(struct Port *p)
+{
+	struct Env *e;
+
+	while ((e = port_dequeue(p))) {
+		e->env_tf.tf_regs.reg_eax = -E_BAD_PORT;
+		sched_wakeup(e);
+	}
+	p->port_owner = 0;
+	p->port_link = port_free_list;
+	port_free_list = p;
+}
+
+//
+// Convert a port ID to a live port.
+//
+// RETURNS
+//   0 on success, -E_BAD_PORT on error.
+//   On success, sets *port_store to the port.
+//
+int
+port_lookup(portid_t portid, struct Port **port_store)
+{
+	struct Port *p;
+
+	if (portid <= 0)
+		return -E_BAD_PORT;
+	p = &ports[PORTX(portid)];
+	if (p->port_owner == 0 || p->port_id != portid)
+		return -E_BAD_PORT;
+	*port_store = p;
+	return 0;
+}
+
+//
+// Allow 'envid' to send on port 'p'.  envid 0 opens the port to every
+// environment.
+//
+// Returns 0 on success, -E_NO_MEM if the grant table is full.
+//
+int
+port_grant(struct Port *p, envid_t envid)
+{
+	int i, slot = -1;
+
+	if (envid == 0) {
+		p->port_public = 1;
+		return 0;
+	}
+	for (i = 0; i < NPORTGRANT; i++) {
+		if (p->port_grants[i] == envid)
+			return 0;
+		if (p->port_grants[i] == 0 && slot < 0)
+			slot = i;
+	}
+	if (slot < 0)
+		return -E_NO_MEM;
+	p->port_grants[slot] = envid;
+	return 0;
+}
+
+bool
+port_may_send(struct Port *p, struct Env *e)
+{
+	int i;
+
+	if (p->port_public || e->env_id == p->port_owner)
+		return 1;
+	for (i = 0; i < NPORTGRANT; i++)
+		if (p->port_grants[i] == e->env_id)
+			return 1;
+	return 0;
+}
+
+// Append 'sender' to p's queue of blocked senders.
+void
+port_enqueue(struct Port *p, struct Env *sender)
+{
+	sender->env_port_sending = p->port_id;
+	sender->env_port_link = NULL;
+	if (p->port_tail)
+		p->port_tail->env_port_link = sender;
+	else
+		p->port_head = sender;
+	p->port_tail = sender;
+}
+
+// Remove and return the oldest sender blocked on 'p', or NULL.
+struct Env *
+port_dequeue(struct Port *p)
+{
+	struct Env *e;
+
+	if (!(e = p->port_head))
+		return NULL;
+	p->port_head = e->env_port_link;
+	if (!p->port_head)
+		p->port_tail = NULL;
+	e->env_port_link = NULL;
+	e->env_port_sending = 0;
+	return e;
+}
+
+//
+// Called when 'e' is freed: take it off any port queue it is blocked
+// on and free the ports it owns.
+//
+void
+port_env_free(struct Env *e)
+{
+	struct Port *p;
+	struct Env **pp, *prev;
+	int i;
+
+	if (e->env_port_sending && port_lookup(e->env_port_sending, &p) == 0) {
+		prev = NULL;
+		for (pp = &p->port_head; *pp; prev = *pp, pp = &(*pp)->env_port_link)
+			if (*pp == e) {
+				*pp = e->env_port_link;
+				if (p->port_tail == e)
+					p->port_tail = prev;
+				break;
+			}
+		e->env_port_link = NULL;
+		e->env_port_sending = 0;
+	}
+	e->env_port_recving = 0;
+
+	for (i = 0; i < NPORT; i++)
+		if (ports[i].port_owner == e->env_id)
+			port_free(&ports[i]);
+}
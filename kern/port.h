@@ -0,0 +1,35 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_KERN_PORT_H
+#define JOS_KERN_PORT_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/env.h>
+
+// Number of environments a port can be granted to.
+#define NPORTGRANT		8
+
+struct Port {
+	portid_t port_id;		// Unique port identifier
+	envid_t port_owner;		// Env that receives on the port; 0 if free
+	int port_priority;		// Higher priority ports are received first
+	envid_t port_grants[NPORTGRANT]; // Envs allowed to send; 0 = unused
+	bool port_public;		// Any env may send
+	struct Env *port_head;		// Senders blocked on this port, FIFO
+	struct Env *port_tail;
+	struct Port *port_link;		// Next free Port
+};
+
+void	port_init(void);
+int	port_alloc(struct Port **port_store, struct Env *owner, int priority);
+void	port_free(struct Port *p);
+int	port_lookup(portid_t portid, struct Port **port_store);
+int	port_grant(struct Port *p, envid_t envid);
+bool	port_may_send(struct Port *p, struct Env *e);
+void	port_enqueue(struct Port *p, struct Env *sender);
+struct Env *port_dequeue(struct Port *p);
+void	port_env_free(struct Env *e);
+
+#endif	// !JOS_KERN_PORT_H
@@ -1,15 +1,54 @@
 // Simple implementation of cprintf console output for the kernel,
 // based on printfmt() and the kernel console's cputchar().
+//
+// Each CPU collects its output in a line buffer and hands whole lines
+// to the console, so that lines printed by different CPUs don't
+// interleave and the console lock is taken once per line rather than
+// once per character.  A partial line goes out when the CPU next
+// echoes or reads console input, or calls cprintf_flush.  After a
+// panic, output bypasses the buffers.
 
 #include <inc/types.h>
 #include <inc/stdio.h>
 #include <inc/stdarg.h>
 
+#include <kern/console.h>
+#include <kern/cpu.h>
+
+#define LINEBUF_SIZE	256
+
+struct LineBuf {
+	char lb_buf[LINEBUF_SIZE];
+	int lb_n;
+};
+
+static struct LineBuf linebufs[NCPU];
+
+// Send this CPU's partial line, if any, to the console.
+void
+cprintf_flush(void)
+{
+	struct LineBuf *lb = &linebufs[cpunum()];
+
+	if (lb->lb_n > 0) {
+		cons_write(lb->lb_buf, lb->lb_n);
+		lb->lb_n = 0;
+	}
+}
 
 static void
 putch(int ch, int *cnt)
 {
-	cputchar(ch);
+	extern const char *panicstr;
+	struct LineBuf *lb = &linebufs[cpunum()];
+
+	if (panicstr) {
+		cputchar(ch);
+		return;
+	}
+	lb->lb_buf[lb->lb_n++] = ch;
+	if (ch == '\n' || lb->lb_n == LINEBUF_SIZE)
+		cprintf_flush();
 	*cnt++;
 }
 
@@ -0,0 +1,170 @@
+// Sampling profiler.
+//
+// While profiling is on, every timer interrupt records the EIP it
+// interrupted, and the env if it interrupted user mode, in the current
+// CPU's sample ring.  Each ring is written only by its own CPU and
+// simply overwrites its oldest samples when full, so taking a sample
+// needs no lock.  Samples are aggregated into hot spots on demand:
+// kernel samples by the function containing them, user samples by env
+// and EIP.
+//
+// Since the kernel runs with interrupts disabled, kernel samples come
+// only from CPUs idling in sched_halt.
+
+#include <inc/assert.h>
+#include <inc/string.h>
+
+#include <kern/cpu.h>
+#include <kern/env.h>
+#include <kern/kdebug.h>
+#include <kern/prof.h>
+#include <kern/sched.h>
+
+#define PROF_NSAMPLE	1024	// Samples kept per CPU
+
+struct ProfSample {
+	uintptr_t ps_eip;
+	envid_t ps_env;
+};
+
+struct ProfRing {
+	struct ProfSample pr_buf[PROF_NSAMPLE];
+	uint32_t pr_head;		// Samples taken since prof_start
+};
+
+volatile bool prof_enabled;
+
+static struct ProfRing rings[NCPU];
+static struct ProfHot hot[PROF_NHOT];
+static int nhot;
+static uint32_t nlost;		// Samples that didn't fit in 'hot'
+
+// Record the interrupted context 'tf' if profiling is on.
+// Called from the timer interrupt.
+void
+prof_sample(struct Trapframe *tf)
+{
+	struct ProfRing *r = &rings[cpunum()];
+	struct ProfSample *s;
+
+	if (!prof_enabled)
+		return;
+	s = &r->pr_buf[r->pr_head % PROF_NSAMPLE];
+	s->ps_eip = tf->tf_eip;
+	s->ps_env = (tf->tf_cs & 3) == 3 && curenv ? curenv->env_id : 0;
+	r->pr_head++;
+}
+
+void
+prof_start(void)
+{
+	int i;
+
+	prof_enabled = 0;
+	for (i = 0; i < ncpu; i++)
+		rings[i].pr_head = 0;
+	prof_enabled = 1;
+	// A CPU that turned its tick off would take no samples.
+	sched_tick_all();
+}
+
+void
+prof_stop(void)
+{
+	prof_enabled = 0;
+}
+
+static void
+prof_add(uintptr_t eip, envid_t env)
+{
+	struct Eipdebuginfo info;
+	int i;
+
+	if (env == 0 && debuginfo_eip(eip, &info) >= 0)
+		eip = info.eip_fn_addr;
+	for (i = 0; i < nhot; i++)
+		if (hot[i].ph_eip == eip && hot[i].ph_env == env) {
+			hot[i].ph_count++;
+			return;
+		}
+	if (nhot == PROF_NHOT) {
+		nlost++;
+		return;
+	}
+	hot[nhot].ph_eip = eip;
+	hot[nhot].ph_env = env;
+	hot[nhot].ph_count = 1;
+	nhot++;
+}
+
+// Aggregate the samples in all the rings into 'hot', hottest first.
+// Returns the number of samples.
+int
+prof_collect(void)
+{
+	struct ProfHot h;
+	uint32_t n, total = 0;
+	int i, j;
+
+	nhot = 0;
+	nlost = 0;
+	for (i = 0; i < ncpu; i++) {
+		n = MIN(rings[i].pr_head, PROF_NSAMPLE);
+		for (j = 0; j < n; j++)
+			prof_add(rings[i].pr_buf[j].ps_eip,
+				 rings[i].pr_buf[j].ps_env);
+		total += n;
+	}
+
+	for (i = 1; i < nhot; i++) {
+		h = hot[i];
+		for (j = i; j > 0 && hot[j - 1].ph_count < h.ph_count; j--)
+			hot[j] = hot[j - 1];
+		hot[j] = h;
+	}
+	return total;
+}
+
+// Print the 'nshow' hottest spots on the console.
+void
+prof_report(int nshow)
+{
+	struct Eipdebuginfo info;
+	uint32_t total;
+	int i;
+
+	total = prof_collect();
+	cprintf("prof: %u samples%s", total, prof_enabled ? " (running)" : "");
+	for (i = 0; i < ncpu; i++)
+		cprintf("%s cpu%d %u", i ? "," : ":", i,
+			MIN(rings[i].pr_head, PROF_NSAMPLE));
+	cprintf("\n");
+	if (total == 0)
+		return;
+
+	for (i = 0; i < nhot && i < nshow; i++) {
+		cprintf("%6u %3u%%  ", hot[i].ph_count,
+			hot[i].ph_count * 100 / total);
+		if (hot[i].ph_env == 0) {
+			debuginfo_eip(hot[i].ph_eip, &info);
+			cprintf("kernel    %08x %.*s (%s)\n", hot[i].ph_eip,
+				info.eip_fn_namelen, info.eip_fn_name,
+				info.eip_file);
+		} else
+			cprintf("env %05x %08x\n", hot[i].ph_env,
+				hot[i].ph_eip);
+	}
+	if (nlost)
+		cprintf("%6u samples in other places\n", nlost);
+}
+
+// Copy up to 'n' of the hottest spots to 'out'.
+// Returns the number copied.
+int
+prof_read(struct ProfHot *out, size_t n)
+{
+	prof_collect();
+	n = MIN(n, nhot);
+	memcpy(out, hot, n * sizeof(struct ProfHot));
+	return n;
+}
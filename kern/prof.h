@@ -0,0 +1,23 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_KERN_PROF_H
+#define JOS_KERN_PROF_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <inc/prof.h>
+
+struct Trapframe;
+
+extern volatile bool prof_enabled;
+
+void	prof_sample(struct Trapframe *tf);
+void	prof_start(void);
+void	prof_stop(void);
+int	prof_collect(void);
+void	prof_report(int nshow);
+int	prof_read(struct ProfHot *hot, size_t n);
+
+#endif	// !JOS_KERN_PROF_H
@@ -4,48 +4,396 @@
 #include <kern/env.h>
 #include <kern/pmap.h>
 #include <kern/monitor.h>
+#include <kern/time.h>
+#include <kern/prof.h>
+#include <kern/trace.h>
+#include <kern/sched.h>
 
-void sched_halt(void);
+// Enough boost to lift the lowest effective priority above the highest.
+#define SCHED_BOOST_MAX \
+	(ENV_PRIO_MAX - ENV_PRIO_MIN + ENV_NICE_MAX - ENV_NICE_MIN + 1)
 
-// Choose a user environment to run and run it.
+void sched_halt(void) __attribute__((noreturn));
+
+// Turn this CPU's periodic timer interrupt on or off.  With it off,
+// a single interrupt is programmed for the next pending timeout, so
+// that a CPU that is idle, or has only one environment to run, is not
+// interrupted just to find nothing else to do.
+static void
+sched_set_tick(bool periodic)
+{
+	unsigned int deadline, nticks;
+
+	if (periodic) {
+		if (thiscpu->cpu_tickless) {
+			lapic_timer_periodic();
+			thiscpu->cpu_tickless = 0;
+		}
+		return;
+	}
+
+	if (timeout_next(&deadline)) {
+		int32_t delta = deadline - time_ticks();
+		lapic_timer_oneshot(delta > 0 ? delta : 1);
+	} else
+		lapic_timer_stop();
+	thiscpu->cpu_tickless = 1;
+}
+
+// Ask CPU 'c' to run the scheduler.
 void
-sched_yield(void)
+sched_kick(struct CpuInfo *c)
 {
-	struct Env *idle;
+	if (c != thiscpu)
+		lapic_ipi_cpu(c->cpu_id, T_RESCHED);
+}
 
-	// Implement simple round-robin scheduling.
-	//
-	// Search through 'envs' for an ENV_RUNNABLE environment in
-	// circular fashion starting just after the env this CPU was
-	// last running.  Switch to the first such environment found.
+// Turn the periodic tick back on everywhere, say because the profiler
+// needs it: on this CPU directly, and on every other tickless CPU by
+// making it reschedule, which decides afresh whether it needs a tick.
+void
+sched_tick_all(void)
+{
+	struct CpuInfo *c;
+
+	sched_set_tick(1);
+	for (c = cpus; c < cpus + ncpu; c++)
+		if (c != thiscpu && c->cpu_tickless
+		    && (c->cpu_status != CPU_HALTED || !xchg(&c->cpu_kicked, 1)))
+			sched_kick(c);
+}
+
+// Is 'e' allowed to run on CPU 'cpu' (see sys_env_set_affinity)?
+static bool
+sched_allowed(struct Env *e, int cpu)
+{
+	return (e->env_cpumask >> cpu) & 1;
+}
+
+// Make 'e' runnable.  If some CPU it may run on is halted, send that
+// CPU a reschedule IPI so the env runs right away.  Otherwise some
+// CPU it may run on has to notice it: if that is this CPU and it has
+// turned off its periodic tick, turn the tick back on; if 'e' may not
+// run here, kick a tickless CPU it may run on.
+void
+sched_wakeup(struct Env *e)
+{
+	struct CpuInfo *c;
+
+	e->env_status = ENV_RUNNABLE;
+	sched_enqueue(e);
+	for (c = cpus; c < cpus + ncpu; c++)
+		if (sched_allowed(e, c - cpus) && c->cpu_status == CPU_HALTED
+		    && !xchg(&c->cpu_kicked, 1)) {
+			sched_kick(c);
+			return;
+		}
+	if (sched_allowed(e, cpunum())) {
+		if (thiscpu->cpu_tickless)
+			sched_set_tick(1);
+		return;
+	}
+	for (c = cpus; c < cpus + ncpu; c++)
+		if (sched_allowed(e, c - cpus) && c->cpu_tickless) {
+			sched_kick(c);
+			return;
+		}
+}
+
+#ifndef SCHED_STRIDE
+
+// Effective priority of a runnable env.
+static int
+sched_priority(struct Env *e)
+{
+	return e->env_priority - e->env_nice + e->env_boost;
+}
+
+// Did 'e' run last on CPU 'cpu', other than as the env being
+// preempted there?
+static bool
+sched_ran_here(struct Env *e, int cpu)
+{
+	return e != curenv && e->env_runs > 0 && e->env_cpunum == cpu;
+}
+
+// Choose the next environment to run, or NULL if there is none.
+// Sets *more if other environments are left waiting.
+static struct Env *
+sched_pick(bool *more)
+{
+	// Run the runnable environment with the highest effective
+	// priority (see sched_priority).  Among equals, prefer one that
+	// last ran on this CPU, whose cache and TLB state may still be
+	// here; otherwise search through 'envs' in circular fashion
+	// starting just after the env this CPU was last running, so equal
+	// priorities share the CPU round-robin.
 	//
-	// If no envs are runnable, but the environment previously
-	// running on this CPU is still ENV_RUNNING, it's okay to
-	// choose that environment.
+	// The environment previously running on this CPU, if it is still
+	// ENV_RUNNING, competes too, but loses ties.
 	//
 	// Never choose an environment that's currently running on
-	// another CPU (env_status == ENV_RUNNING). If there are
-	// no runnable environments, simply drop through to the code
-	// below to halt the cpu.
+	// another CPU (env_status == ENV_RUNNING), or one whose affinity
+	// mask excludes this CPU.
+	//
+	// Every env that is passed over gains some boost, and the chosen
+	// one loses its boost, so waiting envs eventually get to run.
 
-	// LAB 5: Your code here.
 	size_t i;
 	int env_index = -1;
+	int nrunnable = 0;
+	int me = cpunum();
+	struct Env *e, *next = NULL;
 	if (curenv) {
 		env_index = ENVX(curenv->env_id);
 	}
-	for (i = 1; i<NENV; i++) {
-		if (envs[(env_index + i) % NENV].env_status == ENV_RUNNABLE) {
-			env_run(&envs[(env_index + i) % NENV]);
+	for (i = 1; i <= NENV; i++) {
+		e = &envs[(env_index + i) % NENV];
+		if (e->env_status != ENV_RUNNABLE
+		    && !(e == curenv && e->env_status == ENV_RUNNING))
+			continue;
+		if (!sched_allowed(e, me))
+			continue;
+		nrunnable++;
+		if (e->env_boost < SCHED_BOOST_MAX)
+			e->env_boost++;
+		if (!next || sched_priority(e) > sched_priority(next)
+		    || (sched_priority(e) == sched_priority(next)
+			&& sched_ran_here(e, me) && !sched_ran_here(next, me)))
+			next = e;
+	}
+	if (next)
+		next->env_boost = 0;
+	*more = nrunnable > 1;
+	return next;
+}
+
+void
+sched_enqueue(struct Env *e)
+{
+}
+
+void
+sched_remove(struct Env *e)
+{
+}
+
+#else	// SCHED_STRIDE
+
+// Stride scheduling.
+//
+// Each env holds env_tickets and advances its pass value by
+// STRIDE1 / env_tickets every time it is chosen; the runnable env with
+// the lowest pass runs next, so over time each env gets CPU time in
+// proportion to its tickets.
+//
+// Runnable envs wait in a min-heap on env_pass belonging to the CPU
+// they last ran on, or of some CPU in their affinity mask if that one
+// is not.  A CPU whose heap is empty takes work from the fullest one
+// holding an env that may run on it.  Envs that stop being runnable
+// while queued are left in the heap and skipped when they reach the
+// top; envs whose affinity changed while queued are moved then.
+
+struct RunQueue {
+	struct Env *rq_heap[NENV];	// Min-heap on env_pass
+	int rq_n;			// Number of envs in rq_heap
+	uint32_t rq_pass;		// Pass of the env chosen last
+};
+
+static struct RunQueue runqs[NCPU];
+
+static bool
+pass_before(struct Env *a, struct Env *b)
+{
+	return (int32_t) (a->env_pass - b->env_pass) < 0;
+}
+
+static void
+rq_set(struct RunQueue *rq, int i, struct Env *e)
+{
+	rq->rq_heap[i] = e;
+	e->env_rq_idx = i;
+}
+
+static void
+rq_sift_up(struct RunQueue *rq, int i)
+{
+	struct Env *e = rq->rq_heap[i];
+
+	while (i > 0 && pass_before(e, rq->rq_heap[(i - 1) / 2])) {
+		rq_set(rq, i, rq->rq_heap[(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	rq_set(rq, i, e);
+}
+
+static void
+rq_sift_down(struct RunQueue *rq, int i)
+{
+	struct Env *e = rq->rq_heap[i];
+	int child;
+
+	while ((child = 2 * i + 1) < rq->rq_n) {
+		if (child + 1 < rq->rq_n
+		    && pass_before(rq->rq_heap[child + 1], rq->rq_heap[child]))
+			child++;
+		if (!pass_before(rq->rq_heap[child], e))
+			break;
+		rq_set(rq, i, rq->rq_heap[child]);
+		i = child;
+	}
+	rq_set(rq, i, e);
+}
+
+// Remove the env at index i of rq's heap.
+static void
+rq_delete(struct RunQueue *rq, int i)
+{
+	struct Env *last;
+
+	rq->rq_heap[i]->env_rq = -1;
+	if (--rq->rq_n == i)
+		return;
+	last = rq->rq_heap[rq->rq_n];
+	rq_set(rq, i, last);
+	rq_sift_down(rq, i);
+	rq_sift_up(rq, last->env_rq_idx);
+}
+
+// Put a runnable env on the run queue of the CPU it last ran on,
+// if it may still run there.
+void
+sched_enqueue(struct Env *e)
+{
+	struct RunQueue *rq;
+	int cpu = e->env_runs > 0 ? e->env_cpunum : cpunum();
+
+	if (e->env_rq >= 0)
+		return;
+	if (!sched_allowed(e, cpu))
+		for (cpu = 0; cpu < ncpu - 1; cpu++)
+			if (sched_allowed(e, cpu))
+				break;
+	rq = &runqs[cpu];
+	// Don't let an env that slept bank credit against the others.
+	if ((int32_t) (e->env_pass - rq->rq_pass) < 0)
+		e->env_pass = rq->rq_pass;
+	e->env_rq = cpu;
+	rq->rq_heap[rq->rq_n++] = e;
+	rq_sift_up(rq, rq->rq_n - 1);
+}
+
+// Take 'e' off its run queue, if it is on one.
+void
+sched_remove(struct Env *e)
+{
+	if (e->env_rq >= 0)
+		rq_delete(&runqs[e->env_rq], e->env_rq_idx);
+}
+
+// Does 'rq' hold an env that could run on CPU 'cpu' now?  Entries for
+// envs that stopped being runnable while queued don't count.
+static bool
+rq_has_runnable(struct RunQueue *rq, int cpu)
+{
+	struct Env *e;
+	int i;
+
+	for (i = 0; i < rq->rq_n; i++) {
+		e = rq->rq_heap[i];
+		if (e->env_status == ENV_RUNNABLE && sched_allowed(e, cpu))
+			return 1;
+	}
+	return 0;
+}
+
+// Find work for this CPU on another CPU's run queue: the lowest-pass
+// runnable env that may run here, from the fullest queue that has
+// one.  Returns that queue and sets *idx, or returns NULL.
+static struct RunQueue *
+sched_steal(int *idx)
+{
+	struct RunQueue *rq, *best = NULL;
+	struct Env *e, *pick;
+	int i, me = cpunum();
+
+	for (rq = runqs; rq < runqs + ncpu; rq++) {
+		if (rq == &runqs[me] || (best && rq->rq_n <= best->rq_n))
+			continue;
+		pick = NULL;
+		for (i = 0; i < rq->rq_n; i++) {
+			e = rq->rq_heap[i];
+			if (e->env_status == ENV_RUNNABLE && sched_allowed(e, me)
+			    && (!pick || pass_before(e, pick)))
+				pick = e;
+		}
+		if (pick) {
+			best = rq;
+			*idx = pick->env_rq_idx;
 		}
 	}
-	if (curenv && curenv->env_status == ENV_RUNNING) {
-		env_run(curenv);
+	return best;
+}
+
+static struct Env *
+sched_pick(bool *more)
+{
+	struct RunQueue *rq, *mine = &runqs[cpunum()];
+	struct Env *e;
+	int i;
+
+	// The current env competes with the others for this CPU.
+	if (curenv && curenv->env_status == ENV_RUNNING)
+		sched_enqueue(curenv);
+
+	for (;;) {
+		rq = mine;
+		i = 0;
+		if (rq->rq_n == 0 && !(rq = sched_steal(&i)))
+			return NULL;
+
+		e = rq->rq_heap[i];
+		rq_delete(rq, i);
+		if (e->env_status != ENV_RUNNABLE
+		    && !(e == curenv && e->env_status == ENV_RUNNING))
+			continue;
+		if (!sched_allowed(e, cpunum())) {
+			// Affinity changed while queued; move it.
+			sched_enqueue(e);
+			continue;
+		}
+		rq->rq_pass = e->env_pass;
+		e->env_pass += e->env_stride;
+		*more = rq_has_runnable(mine, cpunum());
+		return e;
 	}
-	else {
-		// sched_halt never returns
-		sched_halt();
+}
+
+#endif	// SCHED_STRIDE
+
+// Choose a user environment to run and run it.
+void
+sched_yield(void)
+{
+	struct Env *next;
+	bool more;
+
+	// If the current env may no longer run here, hand it to a CPU
+	// that it may run on.
+	if (curenv && curenv->env_status == ENV_RUNNING
+	    && !sched_allowed(curenv, cpunum()))
+		sched_wakeup(curenv);
+
+	if ((next = sched_pick(&more))) {
+		// Keep the tick only if someone is left waiting,
+		// or the profiler needs it.
+		sched_set_tick(more || prof_enabled);
+		env_run(next);
 	}
+
+	// If there are no runnable environments, halt the cpu.
+	// sched_halt never returns
+	sched_halt();
 }
 
 // Halt this CPU when there is nothing to do. Wait until the
@@ -71,9 +419,17 @@ sched_halt(void)
 	}
 
 	// Mark that no environment is running on this CPU
+	trace_event(TE_IDLE, 0, curenv ? curenv->env_id : 0, 0);
+	if (curenv)
+		curenv->env_kcycles += read_tsc() - thiscpu->cpu_trap_start;
 	curenv = NULL;
+	thiscpu->cpu_pgdir = NULL;
 	lcr3(PADDR(kern_pgdir));
 
+	// Sleep until the next timeout rather than the next tick,
+	// unless the profiler is counting idle time.
+	sched_set_tick(prof_enabled);
+
 	// Mark that this CPU is in the HALT state, so that when
 	// timer interupts come in, we know we should re-acquire the
 	// big kernel lock
@@ -94,5 +450,6 @@ sched_halt(void)
 		"hlt\n"
 		"jmp 1b\n"
 	: : "a" (thiscpu->cpu_ts.ts_esp0));
+	panic("hlt loop exited");  /* mostly to placate the compiler */
 }
 
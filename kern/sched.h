@@ -6,7 +6,15 @@
 # error "This is a JOS kernel header; user programs should not #include it"
 #endif
 
+struct Env;
+struct CpuInfo;
+
 // This function does not return.
 void sched_yield(void) __attribute__((noreturn));
+void sched_wakeup(struct Env *e);
+void sched_kick(struct CpuInfo *c);
+void sched_tick_all(void);
+void sched_enqueue(struct Env *e);
+void sched_remove(struct Env *e);
 
 #endif	// !JOS_KERN_SCHED_H
@@ -7,6 +7,7 @@
 #include <inc/string.h>
 #include <kern/cpu.h>
 #include <kern/spinlock.h>
+#include <kern/pmap.h>
 #include <kern/kdebug.h>
 
 // The big kernel lock
@@ -68,8 +69,12 @@ spin_lock(struct spinlock *lk)
 	// The xchg is atomic.
 	// It also serializes, so that reads after acquire are not
 	// reordered before it. 
-	while (xchg(&lk->locked, 1) != 0)
+	// While spinning, answer TLB shootdowns from the lock holder,
+	// which may be waiting on us.
+	while (xchg(&lk->locked, 1) != 0) {
+		tlb_shootdown_poll();
 		asm volatile ("pause");
+	}
 
 	// Record info about lock acquisition for debugging.
 #ifdef DEBUG_SPINLOCK
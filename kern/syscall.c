@@ -11,6 +11,13 @@
 #include <kern/syscall.h>
 #include <kern/console.h>
 #include <kern/sched.h>
+#include <kern/futex.h>
+#include <kern/time.h>
+#include <kern/port.h>
+#include <kern/prof.h>
+#include <kern/trace.h>
+#include <kern/klog.h>
+#include <kern/syslat.h>
 
 // Print a string to the system console.
 // The string is exactly 'len' characters long.
@@ -22,8 +29,22 @@ sys_cputs(const char *s, size_t len)
 	// Destroy the environment if not.
 	user_mem_assert(curenv, s, len,  PTE_U | PTE_P);
 
-	// Print the string supplied by the user.
-	cprintf("%.*s", len, s);
+	// Print the string supplied by the user.  Its address space is
+	// the current one, so the console copies straight from it, after
+	// anything this CPU has printed so far.
+	cprintf_flush();
+	cons_write(s, len);
+}
+
+// Like sys_cputs, but queue only as much of the string as the console
+// can take without waiting for the serial port.
+// Returns the number of characters queued.
+static int
+sys_cputs_nowait(const char *s, size_t len)
+{
+	user_mem_assert(curenv, s, len,  PTE_U | PTE_P);
+	cprintf_flush();
+	return cons_write_nowait(s, len);
 }
 
 // Read a character from the system console without blocking.
@@ -54,9 +75,9 @@ sys_env_destroy(envid_t envid)
 	if ((r = envid2env(envid, &e, 1)) < 0)
 		return r;
 	if (e == curenv)
-		cprintf("[%08x] exiting gracefully\n", curenv->env_id);
+		klog(KLOG_INFO, "[%08x] exiting gracefully", curenv->env_id);
 	else
-		cprintf("[%08x] destroying %08x\n", curenv->env_id, e->env_id);
+		klog(KLOG_INFO, "[%08x] destroying %08x", curenv->env_id, e->env_id);
 	env_destroy(e);
 	return 0;
 }
@@ -86,6 +107,11 @@ sys_exofork(void)
 	if (alloc_result < 0)
 		return alloc_result;
 	new_env->env_status = ENV_NOT_RUNNABLE;
+	new_env->env_priority = curenv->env_priority;
+	new_env->env_nice = curenv->env_nice;
+	new_env->env_tickets = curenv->env_tickets;
+	new_env->env_stride = curenv->env_stride;
+	new_env->env_cpumask = curenv->env_cpumask;
 	new_env->env_tf = curenv->env_tf;
 	new_env->env_tf.tf_regs.reg_eax = 0;
 	return new_env->env_id;
@@ -113,7 +139,10 @@ sys_env_set_status(envid_t envid, int status)
 		return envid_result;
 	if (status != ENV_RUNNABLE && status != ENV_NOT_RUNNABLE)
 		return -E_INVAL;
-	env->env_status = status;
+	if (status == ENV_RUNNABLE)
+		sched_wakeup(env);
+	else
+		env->env_status = status;
 	return 0;
 
 }
@@ -256,11 +285,93 @@ sys_page_unmap(envid_t envid, void *va)
 
 }
 
+// Map the 'npages' pages starting at 'srcva' in sendenv's address space
+// at 'dstva' in recvenv's address space with permission 'perm'.
+// The caller has checked that both ranges are page-aligned and lie
+// below UTOP.
+//
+// Each page table is walked once per page-table page rather than once
+// per page, and stale TLB entries are flushed once at the end rather
+// than once per page.  If 'move' is set, the pages are unmapped from
+// the sender and its references are handed to the receiver, so pp_ref
+// does not change.
+//
+// Nothing is mapped unless the whole transfer can succeed.
+// Returns 0 on success, < 0 on error.  Errors are:
+//	-E_INVAL if any source page is not mapped, or if (perm & PTE_W)
+//		but a source page is read-only.
+//	-E_NO_MEM if there's no memory for the receiver's page tables.
+static int
+ipc_map_pages(struct Env *sendenv, void *srcva, struct Env *recvenv,
+	      void *dstva, size_t npages, int perm, bool move)
+{
+	pte_t *spte, *dpte;
+	struct PageInfo *pp;
+	bool flush_recv = 0;
+	size_t i;
+
+	// Check every source page before touching anything.
+	spte = NULL;
+	for (i = 0; i < npages; i++) {
+		void *va = srcva + i * PGSIZE;
+		if (!spte || PTX(va) == 0)
+			spte = pgdir_walk(sendenv->env_pgdir, va, 0);
+		else
+			spte++;
+		if (!spte || (*spte & (PTE_P | PTE_U)) != (PTE_P | PTE_U))
+			return -E_INVAL;
+		if ((perm & PTE_W) && !(*spte & PTE_W))
+			return -E_INVAL;
+	}
+
+	// Allocate any page tables the receiver is missing up front,
+	// so the transfer below cannot fail halfway through.
+	for (i = 0; i < npages; i++) {
+		void *va = dstva + i * PGSIZE;
+		if ((i == 0 || PTX(va) == 0) && !pgdir_walk(recvenv->env_pgdir, va, 1))
+			return -E_NO_MEM;
+	}
+
+	spte = dpte = NULL;
+	for (i = 0; i < npages; i++) {
+		void *sva = srcva + i * PGSIZE;
+		void *dva = dstva + i * PGSIZE;
+		if (!spte || PTX(sva) == 0)
+			spte = pgdir_walk(sendenv->env_pgdir, sva, 0);
+		else
+			spte++;
+		if (!dpte || PTX(dva) == 0)
+			dpte = pgdir_walk(recvenv->env_pgdir, dva, 0);
+		else
+			dpte++;
+
+		pp = pa2page(PTE_ADDR(*spte));
+		if (!move)
+			pp->pp_ref++;
+		if (*dpte & PTE_P) {
+			page_decref(pa2page(PTE_ADDR(*dpte)));
+			flush_recv = 1;
+		}
+		*dpte = page2pa(pp) | perm | PTE_P;
+		if (move)
+			*spte = 0;
+	}
+
+	// One shootdown per address space for the whole range.
+	if (flush_recv)
+		tlb_invalidate_range(recvenv->env_pgdir, dstva, npages);
+	if (move)
+		tlb_invalidate_range(sendenv->env_pgdir, srcva, npages);
+	return 0;
+}
+
 static int
-ipc_helper(envid_t recvenvid, envid_t sendenvid, uint32_t value, void *srcva, unsigned perm)
+ipc_helper(envid_t recvenvid, envid_t sendenvid, uint32_t value, void *srcva,
+	   size_t npages, unsigned perm)
 {
 	struct Env *recvenv;
 	struct Env *sendenv;
+	size_t n;
 	if (envid2env(recvenvid, &recvenv, 0) < 0) {
 		return -E_BAD_ENV;
 	}
@@ -268,37 +379,79 @@ ipc_helper(envid_t recvenvid, envid_t sendenvid, uint32_t value, void *srcva, un
 		return -E_BAD_ENV;
 	}
 	recvenv->env_ipc_perm = 0;
+	n = 0;
 	if (srcva < (void *) UTOP && (recvenv->env_ipc_dstva < (void *) UTOP) ) {
 		if ( ((int) srcva%PGSIZE) !=0) {
 			return -E_INVAL;
 		}
-		if (!(perm & (PTE_U | PTE_P)) ) {
-			return -E_INVAL;
-		}
-		pte_t * pte;	
-		struct PageInfo * srcpage = page_lookup(sendenv->env_pgdir, srcva, &pte);	
-		if (!(srcpage) ) {
+		if (npages > ((uintptr_t) UTOP - (uintptr_t) srcva) / PGSIZE) {
 			return -E_INVAL;
 		}
-
-		if ((perm & PTE_W) && !(*pte & PTE_W)) {
+		if (!(perm & (PTE_U | PTE_P)) ) {
 			return -E_INVAL;
 		}
-		int insert_result = page_insert(recvenv->env_pgdir, srcpage,
-						recvenv->env_ipc_dstva, perm);
-		if(insert_result < 0) {
-			return -E_NO_MEM;
+		// Transfer as much of the range as the receiver's window holds.
+		n = MIN(npages, (size_t) recvenv->env_ipc_npages);
+		int map_result = ipc_map_pages(sendenv, srcva, recvenv,
+					       recvenv->env_ipc_dstva, n,
+					       perm & PTE_SYSCALL, perm & IPC_MOVE);
+		if (map_result < 0) {
+			return map_result;
 		}
-		recvenv->env_ipc_perm = perm;
+		if (n > 0)
+			recvenv->env_ipc_perm = perm & PTE_SYSCALL;
 	}
 	//send value
 	recvenv->env_ipc_recving = 0;
+	timeout_cancel(recvenv);
 	recvenv->env_ipc_from = sendenvid;
 	recvenv->env_ipc_value = value;
+	recvenv->env_ipc_npages = n;
+	recvenv->env_ipc_port = 0;
 	recvenv->env_tf.tf_regs.reg_eax = 0;
-	recvenv->env_status = ENV_RUNNABLE;
+	trace_event(TE_IPC_SEND, sendenvid, recvenvid, value);
+	sendenv->env_ipc_sent++;
+	recvenv->env_ipc_recvd++;
+	if (recvenv != curenv)
+		sched_wakeup(recvenv);
 	return 0;
 }
+
+// Like sys_ipc_send, but transfer up to 'npages' contiguous pages
+// starting at 'srcva' in a single rendezvous.  The number of pages
+// actually mapped is the smaller of 'npages' and the window the
+// receiver passed to sys_ipc_recv_pages; the receiver finds it in
+// env_ipc_npages.
+//
+// If perm includes IPC_MOVE, the transferred pages are unmapped from
+// the sender rather than shared.
+//
+// Errors are as for sys_ipc_send, plus:
+//	-E_INVAL if srcva < UTOP but the range extends past UTOP.
+//	-E_INVAL if any page in the transferred range is not mapped.
+static int
+sys_ipc_send_pages(envid_t envid, uint32_t value, void *srcva, size_t npages,
+		   unsigned perm)
+{
+	struct Env * e;	
+	if (envid2env(envid, &e, 0) < 0) {
+		return -E_BAD_ENV;
+	}
+	// check if there is a recving env, if not, we save our parameters
+	// and set ourselves NOTRUNNABLE
+	if (!e->env_ipc_recving) {
+		curenv->value_to_send = value;
+		curenv->srcva_to_send = srcva;
+		curenv->npages_to_send = npages;
+		curenv->perm_for_send = perm;
+		e->env_senders[e->senders_count] = curenv->env_id;
+		e->senders_count++;
+		curenv->env_status = ENV_NOT_RUNNABLE;
+		sys_yield();
+	}
+	return ipc_helper(envid, curenv->env_id, value, srcva, npages, perm);
+}
+
 // Try to send 'value' to the target env 'envid'.
 // If srcva < UTOP, then also send page currently mapped at 'srcva',
 // so that receiver gets a duplicate mapping of the same page.
@@ -340,48 +493,43 @@ ipc_helper(envid_t recvenvid, envid_t sendenvid, uint32_t value, void *srcva, un
 static int
 sys_ipc_send(envid_t envid, uint32_t value, void *srcva, unsigned perm)
 {
-	struct Env * e;	
-	if (envid2env(envid, &e, 0) < 0) {
-		return -E_BAD_ENV;
-	}
-	// check if there is a recving env, if not, we save our parameters
-	// and set ourselves NOTRUNNABLE
-	if (!e->env_ipc_recving) {
-		curenv->value_to_send = value;
-		curenv->srcva_to_send = srcva;
-		curenv->perm_for_send = perm;
-		e->env_senders[e->senders_count] = curenv->env_id;
-		e->senders_count++;
-		curenv->env_status = ENV_NOT_RUNNABLE;
-		sys_yield();
-	}
-	return ipc_helper(envid, curenv->env_id, value, srcva, perm);
+	return sys_ipc_send_pages(envid, value, srcva, 1, perm);
 }
 
-// Block until a value is ready.  Record that you want to receive
-// using the env_ipc_recving and env_ipc_dstva fields of struct Env,
-// mark yourself not runnable, and then give up the CPU.
-//
-// If 'dstva' is < UTOP, then you are willing to receive a page of data.
-// 'dstva' is the virtual address at which the sent page should be mapped.
+// Receive into a window of 'npages' pages at 'dstva'.  If no sender is
+// queued, block for at most 'timeout' ticks: forever if timeout < 0,
+// not at all if timeout == 0.
 //
-// This function only returns on error, but the system call will eventually
-// return 0 on success.
 // Return < 0 on error.  Errors are:
-//	-E_INVAL if dstva < UTOP but dstva is not page-aligned.
+//	-E_INVAL if dstva < UTOP but dstva is not page-aligned,
+//		or the window extends past UTOP.
+//	-E_WOULD_BLOCK if timeout == 0 and no sender is waiting.
+// A timed-out wait returns -E_TIMEOUT to the environment.
 static int
-sys_ipc_recv(void *dstva)
+ipc_recv_helper(void *dstva, size_t npages, int32_t timeout)
 {
 
 	if ((dstva < (void *)UTOP) && ((int)dstva % PGSIZE) != 0) {
 		return -E_INVAL;
 	}
+	if ((dstva < (void *)UTOP) &&
+	    npages > ((uintptr_t) UTOP - (uintptr_t) dstva) / PGSIZE) {
+		return -E_INVAL;
+	}
 
 	// Go to sleep if count == 0
 	if (curenv->senders_count == 0) {
+		if (timeout == 0) {
+			return -E_WOULD_BLOCK;
+		}
 		curenv->env_ipc_recving = 1;
 		curenv->env_ipc_dstva = dstva;
+		curenv->env_ipc_npages = npages;
 		curenv->env_status = ENV_NOT_RUNNABLE;
+		trace_event(TE_IPC_RECV, curenv->env_id, 0, 0);
+		if (timeout > 0) {
+			timeout_add(curenv, timeout, -E_TIMEOUT);
+		}
 		sys_yield();
 		return 0; // for compiler
 	}
@@ -394,22 +542,479 @@ sys_ipc_recv(void *dstva)
 		return -E_BAD_ENV;
 	}
 	curenv->env_ipc_dstva = dstva;
+	curenv->env_ipc_npages = npages;
 	int helper_result = ipc_helper(curenv->env_id, sendenvid, sendenv->value_to_send,
-			sendenv->srcva_to_send, sendenv->perm_for_send);
-	if (helper_result < 0) {
-		return helper_result;
+			sendenv->srcva_to_send, sendenv->npages_to_send,
+			sendenv->perm_for_send);
+	// Either way the sender's send is over; pass it the result.
+	sendenv->env_tf.tf_regs.reg_eax = helper_result;
+	sched_wakeup(sendenv);
+	return helper_result;
+}
+
+// Like sys_ipc_recv, but accept up to 'npages' contiguous pages mapped
+// starting at 'dstva'.
+//
+// Return < 0 on error.  Errors are:
+//	-E_INVAL if dstva < UTOP but dstva is not page-aligned,
+//		or the window extends past UTOP.
+static int
+sys_ipc_recv_pages(void *dstva, size_t npages)
+{
+	return ipc_recv_helper(dstva, npages, -1);
+}
+
+// Like sys_ipc_recv, but never block: if no sender is waiting, return
+// -E_WOULD_BLOCK immediately.
+static int
+sys_ipc_try_recv(void *dstva)
+{
+	return ipc_recv_helper(dstva, 1, 0);
+}
+
+// Like sys_ipc_recv, but give up after 'nticks' timer ticks, in which
+// case the system call returns -E_TIMEOUT.  nticks == 0 behaves like
+// sys_ipc_try_recv.
+static int
+sys_ipc_recv_timed(void *dstva, unsigned int nticks)
+{
+	if ((int32_t) nticks < 0)
+		return -E_INVAL;
+	return ipc_recv_helper(dstva, 1, nticks);
+}
+
+// Block until a value is ready.  Record that you want to receive
+// using the env_ipc_recving and env_ipc_dstva fields of struct Env,
+// mark yourself not runnable, and then give up the CPU.
+//
+// If 'dstva' is < UTOP, then you are willing to receive a page of data.
+// 'dstva' is the virtual address at which the sent page should be mapped.
+//
+// This function only returns on error, but the system call will eventually
+// return 0 on success.
+// Return < 0 on error.  Errors are:
+//	-E_INVAL if dstva < UTOP but dstva is not page-aligned.
+static int
+sys_ipc_recv(void *dstva)
+{
+	return sys_ipc_recv_pages(dstva, 1);
+}
+
+// Block until another environment calls sys_futex_wake on the word at
+// 'va', provided that the word still contains 'expected'.  The word is
+// identified by its physical address, so environments sharing the page
+// at different virtual addresses wait on the same queue.
+//
+// This function only returns on error, but the system call will
+// return 0 once the environment is woken.
+// Return < 0 on error.  Errors are:
+//	-E_INVAL if va >= UTOP or va is not 4-byte aligned.
+//	-E_FAULT if va is not mapped in the caller's address space.
+//	-E_WOULD_BLOCK if *va != expected.
+static int
+sys_futex_wait(uint32_t *va, uint32_t expected)
+{
+	return futex_wait(curenv, va, expected);
+}
+
+// Wake up to 'n' environments blocked in sys_futex_wait on the word
+// at 'va'.
+//
+// Returns the number of environments woken, < 0 on error.
+// Errors are:
+//	-E_INVAL if va >= UTOP or va is not 4-byte aligned.
+//	-E_FAULT if va is not mapped in the caller's address space.
+static int
+sys_futex_wake(uint32_t *va, int n)
+{
+	return futex_wake(curenv, va, n);
+}
+
+// Create a port owned by the current environment.  Messages on ports
+// with a higher 'priority' are received before those on lower ones.
+//
+// Returns the new port's ID on success, < 0 on error.  Errors are:
+//	-E_NO_FREE_PORT if all ports are in use.
+static portid_t
+sys_port_create(int priority)
+{
+	struct Port *p;
+	int r;
+
+	if ((r = port_alloc(&p, curenv, priority)) < 0)
+		return r;
+	return p->port_id;
+}
+
+// Look up 'portid' and check that the current environment owns it.
+static int
+port_lookup_owned(portid_t portid, struct Port **port_store)
+{
+	int r;
+
+	if ((r = port_lookup(portid, port_store)) < 0)
+		return r;
+	if ((*port_store)->port_owner != curenv->env_id)
+		return -E_BAD_PORT;
+	return 0;
+}
+
+// Allow 'envid' to send on the current environment's port 'portid'.
+// envid 0 lets every environment send.
+//
+// Returns 0 on success, < 0 on error.  Errors are:
+//	-E_BAD_PORT if portid doesn't exist or is not owned by the caller.
+//	-E_NO_MEM if the port cannot be granted to any more environments.
+static int
+sys_port_grant(portid_t portid, envid_t envid)
+{
+	struct Port *p;
+	int r;
+
+	if ((r = port_lookup_owned(portid, &p)) < 0)
+		return r;
+	return port_grant(p, envid);
+}
+
+// Destroy the current environment's port 'portid'.  Environments
+// blocked sending on it fail with -E_BAD_PORT.
+static int
+sys_port_destroy(portid_t portid)
+{
+	struct Port *p;
+	int r;
+
+	if ((r = port_lookup_owned(portid, &p)) < 0)
+		return r;
+	port_free(p);
+	return 0;
+}
+
+// Send 'value', and the page at 'srcva' if srcva < UTOP, on 'portid'.
+// If the port's owner is blocked in sys_port_recv on this port the
+// message is delivered at once; otherwise the caller waits in the
+// port's queue until the owner receives it.
+//
+// Returns 0 on success, < 0 on error.  Errors are:
+//	-E_BAD_PORT if portid doesn't exist, or the caller has not been
+//		granted the right to send on it, or the port is destroyed
+//		while the caller waits.
+//	Otherwise as for sys_ipc_send.
+static int
+sys_port_send(portid_t portid, uint32_t value, void *srcva, unsigned perm)
+{
+	struct Port *p;
+	struct Env *owner;
+	int r;
+
+	if ((r = port_lookup(portid, &p)) < 0)
+		return r;
+	if (!port_may_send(p, curenv))
+		return -E_BAD_PORT;
+	if ((r = envid2env(p->port_owner, &owner, 0)) < 0)
+		return r;
+
+	if (!owner->env_port_recving ||
+	    !(owner->env_port_mask & (1ULL << PORTX(portid)))) {
+		curenv->value_to_send = value;
+		curenv->srcva_to_send = srcva;
+		curenv->npages_to_send = 1;
+		curenv->perm_for_send = perm;
+		port_enqueue(p, curenv);
+		curenv->env_status = ENV_NOT_RUNNABLE;
+		sys_yield();
+	}
+
+	if ((r = ipc_helper(owner->env_id, curenv->env_id, value, srcva, 1, perm)) < 0)
+		return r;
+	owner->env_port_recving = 0;
+	owner->env_ipc_port = portid;
+	return 0;
+}
+
+// Receive a message on one of the 'nports' ports listed in 'ports',
+// all of which must be owned by the caller.  If senders are waiting on
+// several of them, the highest-priority port is served first, with
+// ties going to the port listed first.  Otherwise block until a
+// message arrives on any of them.  The port used is reported in
+// env_ipc_port; the other results are as for sys_ipc_recv.
+//
+// Return < 0 on error.  Errors are:
+//	-E_INVAL if nports is not between 1 and NPORT,
+//		or dstva < UTOP but dstva is not page-aligned.
+//	-E_BAD_PORT if a port doesn't exist or is not owned by the caller.
+static int
+sys_port_recv(const portid_t *ports, int nports, void *dstva)
+{
+	struct Port *p, *best;
+	struct Env *sender;
+	uint64_t mask;
+	int i, r;
+
+	if (nports <= 0 || nports > NPORT)
+		return -E_INVAL;
+	if ((dstva < (void *)UTOP) && ((int)dstva % PGSIZE) != 0)
+		return -E_INVAL;
+	user_mem_assert(curenv, ports, nports * sizeof(portid_t), PTE_U);
+
+	mask = 0;
+	for (i = 0; i < nports; i++) {
+		if ((r = port_lookup_owned(ports[i], &p)) < 0)
+			return r;
+		mask |= 1ULL << PORTX(ports[i]);
 	}
-	// set the sending env to be runnable again.
-	sendenv->env_tf.tf_regs.reg_eax = 0;
-	sendenv->env_status = ENV_RUNNABLE;
+
+	curenv->env_ipc_dstva = dstva;
+	curenv->env_ipc_npages = 1;
+	for (;;) {
+		best = NULL;
+		for (i = 0; i < nports; i++) {
+			port_lookup(ports[i], &p);
+			if (p->port_head &&
+			    (!best || p->port_priority > best->port_priority))
+				best = p;
+		}
+		if (!best)
+			break;
+
+		// A sender whose message cannot be delivered (say, its
+		// page is no longer mapped) gets the error; try the next.
+		sender = port_dequeue(best);
+		r = ipc_helper(curenv->env_id, sender->env_id,
+			       sender->value_to_send, sender->srcva_to_send,
+			       1, sender->perm_for_send);
+		sender->env_tf.tf_regs.reg_eax = r;
+		sched_wakeup(sender);
+		if (r == 0) {
+			curenv->env_ipc_port = best->port_id;
+			return 0;
+		}
+	}
+
+	curenv->env_port_recving = 1;
+	curenv->env_port_mask = mask;
+	curenv->env_status = ENV_NOT_RUNNABLE;
+	sys_yield();
+	return 0; // for compiler
+}
+
+// Return the envid of a live environment of the given type, or 0 if
+// there is none.  The kernel keeps this up to date as environments are
+// created and destroyed, so the lookup does not scan envs[].
+static envid_t
+sys_env_lookup_type(enum EnvType type)
+{
+	return env_lookup_type(type);
+}
+
+// Return the time in nanoseconds since boot.  The result is 64 bits
+// wide; the high half is returned in %edx.
+static int32_t
+sys_time_ns(void)
+{
+	uint64_t ns = time_ns();
+
+	curenv->env_tf.tf_regs.reg_edx = ns >> 32;
+	return (uint32_t) ns;
+}
+
+// Block for at least the given number of nanoseconds, rounded up to a
+// whole number of timer ticks.  The sleeping env is not runnable.
+static int
+sys_sleep(uint32_t ns_lo, uint32_t ns_hi)
+{
+	uint64_t nticks = time_ns_to_ticks(((uint64_t) ns_hi << 32) | ns_lo);
+
+	if (nticks == 0)
+		return 0;
+	if (nticks > 0x7FFFFFFF)
+		return -E_INVAL;
+	timeout_add(curenv, nticks, 0);
+	curenv->env_status = ENV_NOT_RUNNABLE;
+	sys_yield();
+	return 0; // for compiler
+}
+
+// Set envid's scheduling priority and nice value.  Among runnable
+// environments, those with the highest priority - nice run first.
+//
+// Returns 0 on success, < 0 on error.  Errors are:
+//	-E_BAD_ENV if environment envid doesn't currently exist,
+//		or the caller doesn't have permission to change envid.
+//	-E_INVAL if priority or nice is out of range.
+static int
+sys_env_set_priority(envid_t envid, int priority, int nice)
+{
+	struct Env *e;
+	int r;
+
+	if ((r = envid2env(envid, &e, 1)) < 0)
+		return r;
+	if (priority < ENV_PRIO_MIN || priority > ENV_PRIO_MAX
+	    || nice < ENV_NICE_MIN || nice > ENV_NICE_MAX)
+		return -E_INVAL;
+	e->env_priority = priority;
+	e->env_nice = nice;
+	return 0;
+}
+
+// Set envid's stride scheduling tickets.  When the kernel is built
+// with SCHED_STRIDE, runnable environments get CPU time in proportion
+// to their tickets.
+//
+// Returns 0 on success, < 0 on error.  Errors are:
+//	-E_BAD_ENV if environment envid doesn't currently exist,
+//		or the caller doesn't have permission to change envid.
+//	-E_INVAL if tickets is not between 1 and ENV_TICKETS_MAX.
+static int
+sys_env_set_tickets(envid_t envid, uint32_t tickets)
+{
+	struct Env *e;
+	int r;
+
+	if ((r = envid2env(envid, &e, 1)) < 0)
+		return r;
+	if (tickets < 1 || tickets > ENV_TICKETS_MAX)
+		return -E_INVAL;
+	e->env_tickets = tickets;
+	e->env_stride = STRIDE1 / tickets;
 	return 0;
 }
 
+// Restrict envid to run only on the CPUs in 'mask' (bit i stands for
+// the CPU whose env_cpunum is i).  If it is running elsewhere, it is
+// moved at once.
+//
+// Returns 0 on success, < 0 on error.  Errors are:
+//	-E_BAD_ENV if environment envid doesn't currently exist,
+//		or the caller doesn't have permission to change envid.
+//	-E_INVAL if mask contains none of the CPUs in the system.
+static int
+sys_env_set_affinity(envid_t envid, uint32_t mask)
+{
+	struct Env *e;
+	int r;
+
+	if ((r = envid2env(envid, &e, 1)) < 0)
+		return r;
+	if (ncpu < 32)
+		mask &= (1U << ncpu) - 1;
+	if (mask == 0)
+		return -E_INVAL;
+	e->env_cpumask = mask;
+	if (e->env_status == ENV_RUNNING && !(mask & (1U << e->env_cpunum)))
+		sched_kick(&cpus[e->env_cpunum]);
+	return 0;
+}
 
+// Control the sampling profiler.  'op' is one of
+//	PROF_START: discard old samples and start sampling.
+//	PROF_STOP: stop sampling.
+//	PROF_REPORT: print the 'n' hottest spots on the console.
+//	PROF_READ: copy up to 'n' hottest spots, hottest first, into the
+//		struct ProfHot array at 'buf'.
+//
+// Returns 0, or for PROF_READ the number of hot spots copied,
+// on success, < 0 on error.  Errors are:
+//	-E_INVAL if op is not one of the above.
+static int
+sys_prof(int op, struct ProfHot *buf, size_t n)
+{
+	switch (op) {
+	case PROF_START:
+		prof_start();
+		return 0;
+	case PROF_STOP:
+		prof_stop();
+		return 0;
+	case PROF_REPORT:
+		prof_report(n);
+		return 0;
+	case PROF_READ:
+		n = MIN(n, PROF_NHOT);
+		user_mem_assert(curenv, buf, n * sizeof(struct ProfHot),
+				PTE_U | PTE_W);
+		return prof_read(buf, n);
+	default:
+		return -E_INVAL;
+	}
+}
+
+// Control event tracing.  'op' is one of
+//	TRACE_START: discard old events and start tracing.
+//	TRACE_STOP: stop tracing.
+//	TRACE_DUMP: dump the trace buffers on the console.
+//
+// Returns 0 on success, < 0 on error.  Errors are:
+//	-E_INVAL if op is not one of the above.
+static int
+sys_trace(int op)
+{
+	switch (op) {
+	case TRACE_START:
+		trace_start();
+		return 0;
+	case TRACE_STOP:
+		trace_stop();
+		return 0;
+	case TRACE_DUMP:
+		trace_dump();
+		return 0;
+	default:
+		return -E_INVAL;
+	}
+}
+
+// Print kernel log messages up to 'level' (KLOG_*) on the console;
+// all messages stay readable at ULOG.
+//
+// Returns the previous level on success, < 0 on error.  Errors are:
+//	-E_INVAL if level is not a valid log level.
+static int
+sys_klog_set_console(int level)
+{
+	return klog_set_console(level);
+}
+
+// Control the syscall latency histograms.  'op' is one of
+//	SYSLAT_START: clear the histograms and start recording.
+//	SYSLAT_STOP: stop recording.
+//	SYSLAT_REPORT: print percentiles for 'syscallno' on the console,
+//		or for every syscall if 'syscallno' is NSYSCALLS.
+//	SYSLAT_READ: copy the histogram for 'syscallno', summed over all
+//		CPUs, into the SYSLAT_NBUCKET counts at 'hist'.
+//
+// Returns 0, or for SYSLAT_READ the number of calls in the histogram,
+// on success, < 0 on error.  Errors are:
+//	-E_INVAL if op is not one of the above.
+//	-E_INVAL if syscallno is out of range.
+static int
+sys_syslat(int op, uint32_t syscallno, uint32_t *hist)
+{
+	switch (op) {
+	case SYSLAT_START:
+		syslat_start();
+		return 0;
+	case SYSLAT_STOP:
+		syslat_stop();
+		return 0;
+	case SYSLAT_REPORT:
+		if (syscallno > NSYSCALLS)
+			return -E_INVAL;
+		syslat_report(syscallno == NSYSCALLS ? -1 : (int) syscallno);
+		return 0;
+	case SYSLAT_READ:
+		user_mem_assert(curenv, hist, SYSLAT_NBUCKET * sizeof(uint32_t),
+				PTE_U | PTE_W);
+		return syslat_read(syscallno, hist);
+	default:
+		return -E_INVAL;
+	}
+}
 
 // Dispatches to the correct kernel function, passing the arguments.
-int32_t
-syscall(uint32_t syscallno, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5)
+static int32_t
+syscall_dispatch(uint32_t syscallno, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5)
 {
 	// Call the function corresponding to the 'syscallno' parameter.
 	// Return any appropriate return value.
@@ -418,6 +1023,8 @@ syscall(uint32_t syscallno, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4,
 	case SYS_cputs:
 		sys_cputs((char *) a1, a2);
 		return 0;
+	case SYS_cputs_nowait:
+		return sys_cputs_nowait((char *) a1, a2);
 	case SYS_cgetc:
 		return sys_cgetc();
 	case SYS_getenvid:
@@ -443,8 +1050,65 @@ syscall(uint32_t syscallno, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4,
 		return sys_ipc_recv((void *)a1);
 	case SYS_ipc_send:
 		return sys_ipc_send( (envid_t) a1, a2, (void *) a3, (unsigned) a4); 
+	case SYS_ipc_send_pages:
+		return sys_ipc_send_pages((envid_t) a1, a2, (void *) a3, a4, (unsigned) a5);
+	case SYS_ipc_recv_pages:
+		return sys_ipc_recv_pages((void *) a1, a2);
+	case SYS_ipc_try_recv:
+		return sys_ipc_try_recv((void *) a1);
+	case SYS_ipc_recv_timed:
+		return sys_ipc_recv_timed((void *) a1, a2);
+	case SYS_futex_wait:
+		return sys_futex_wait((uint32_t *) a1, a2);
+	case SYS_futex_wake:
+		return sys_futex_wake((uint32_t *) a1, (int) a2);
+	case SYS_port_create:
+		return sys_port_create(a1);
+	case SYS_port_grant:
+		return sys_port_grant((portid_t) a1, (envid_t) a2);
+	case SYS_port_destroy:
+		return sys_port_destroy((portid_t) a1);
+	case SYS_port_send:
+		return sys_port_send((portid_t) a1, a2, (void *) a3, (unsigned) a4);
+	case SYS_port_recv:
+		return sys_port_recv((const portid_t *) a1, a2, (void *) a3);
+	case SYS_env_lookup_type:
+		return sys_env_lookup_type((enum EnvType) a1);
+	case SYS_time_ns:
+		return sys_time_ns();
+	case SYS_sleep:
+		return sys_sleep(a1, a2);
+	case SYS_env_set_priority:
+		return sys_env_set_priority((envid_t) a1, a2, a3);
+	case SYS_env_set_tickets:
+		return sys_env_set_tickets((envid_t) a1, a2);
+	case SYS_env_set_affinity:
+		return sys_env_set_affinity((envid_t) a1, a2);
+	case SYS_prof:
+		return sys_prof(a1, (struct ProfHot *) a2, a3);
+	case SYS_trace:
+		return sys_trace(a1);
+	case SYS_klog_set_console:
+		return sys_klog_set_console(a1);
+	case SYS_syslat:
+		return sys_syslat(a1, a2, (uint32_t *) a3);
 	default:
 		return -E_INVAL;
 	}
 }
 
+// Runs a system call, timing it if syslat is recording.
+int32_t
+syscall(uint32_t syscallno, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5)
+{
+	uint64_t start;
+	int32_t r;
+
+	if (!syslat_enabled)
+		return syscall_dispatch(syscallno, a1, a2, a3, a4, a5);
+	start = read_tsc();
+	r = syscall_dispatch(syscallno, a1, a2, a3, a4, a5);
+	syslat_record(syscallno, read_tsc() - start);
+	return r;
+}
+
@@ -0,0 +1,119 @@
+// System call latency histograms.
+//
+// While recording is on, syscall() times each system call with the TSC
+// and counts it in a log2 histogram for its syscall number.  Each CPU
+// has its own histograms, written only by that CPU, so recording needs
+// no lock; they are merged when read.  When recording is off the only
+// cost is the test of syslat_enabled in syscall().
+//
+// Only system calls that return through syscall() are timed.  Those
+// that give up the CPU (sys_yield, or a receive that blocks) resume in
+// user mode directly and are not counted.
+
+#include <inc/assert.h>
+#include <inc/error.h>
+#include <inc/string.h>
+#include <inc/syscall.h>
+
+#include <kern/cpu.h>
+#include <kern/syslat.h>
+
+volatile bool syslat_enabled;
+
+static uint32_t hists[NCPU][NSYSCALLS][SYSLAT_NBUCKET];
+
+// Count a call to 'syscallno' that took 'cycles' TSC cycles.
+void
+syslat_record(uint32_t syscallno, uint64_t cycles)
+{
+	uint32_t c;
+
+	if (syscallno >= NSYSCALLS)
+		return;
+	c = cycles > 0xffffffff ? 0xffffffff : cycles;
+	hists[cpunum()][syscallno][31 - __builtin_clz(c | 1)]++;
+}
+
+void
+syslat_start(void)
+{
+	syslat_enabled = 0;
+	memset(hists, 0, sizeof(hists));
+	syslat_enabled = 1;
+}
+
+void
+syslat_stop(void)
+{
+	syslat_enabled = 0;
+}
+
+// Merge the CPUs' histograms for 'syscallno' into 'hist'.
+// Returns the number of calls counted.
+static uint32_t
+syslat_merge(uint32_t syscallno, uint32_t *hist)
+{
+	uint32_t total = 0;
+	int i, b;
+
+	for (b = 0; b < SYSLAT_NBUCKET; b++) {
+		hist[b] = 0;
+		for (i = 0; i < ncpu; i++)
+			hist[b] += hists[i][syscallno][b];
+		total += hist[b];
+	}
+	return total;
+}
+
+// Returns the upper bound, in cycles, of the bucket holding the
+// 'pct' percentile of the 'total' calls counted in 'hist'.
+static uint32_t
+syslat_percentile(const uint32_t *hist, uint32_t total, int pct)
+{
+	uint64_t rank = ((uint64_t) total * pct + 99) / 100;
+	uint32_t seen = 0;
+	int b;
+
+	for (b = 0; b < SYSLAT_NBUCKET - 1; b++) {
+		seen += hist[b];
+		if (seen >= rank)
+			break;
+	}
+	return b == SYSLAT_NBUCKET - 1 ? 0xffffffff : (2U << b) - 1;
+}
+
+// Print the median, 90th and 99th percentile and maximum latency of
+// 'syscallno', or of every syscall that was called if it is < 0.
+// Latencies are bucket upper bounds in TSC cycles.
+void
+syslat_report(int syscallno)
+{
+	uint32_t hist[SYSLAT_NBUCKET], total;
+	int i;
+
+	cprintf("syslat: cycles by syscall%s\n",
+		syslat_enabled ? " (running)" : "");
+	for (i = 0; i < NSYSCALLS; i++) {
+		if (syscallno >= 0 && i != syscallno)
+			continue;
+		if ((total = syslat_merge(i, hist)) == 0)
+			continue;
+		cprintf("syslat: %2d n %u p50 %u p90 %u p99 %u max %u\n",
+			i, total,
+			syslat_percentile(hist, total, 50),
+			syslat_percentile(hist, total, 90),
+			syslat_percentile(hist, total, 99),
+			syslat_percentile(hist, total, 100));
+	}
+}
+
+// Copy the merged histogram of 'syscallno' into 'hist', which holds
+// SYSLAT_NBUCKET counts.  Returns the number of calls counted, or
+// -E_INVAL if 'syscallno' is out of range.
+int
+syslat_read(uint32_t syscallno, uint32_t *hist)
+{
+	if (syscallno >= NSYSCALLS)
+		return -E_INVAL;
+	return syslat_merge(syscallno, hist);
+}
@@ -0,0 +1,20 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_KERN_SYSLAT_H
+#define JOS_KERN_SYSLAT_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <inc/syslat.h>
+
+extern volatile bool syslat_enabled;
+
+void	syslat_record(uint32_t syscallno, uint64_t cycles);
+void	syslat_start(void);
+void	syslat_stop(void);
+void	syslat_report(int syscallno);
+int	syslat_read(uint32_t syscallno, uint32_t *hist);
+
+#endif	// !JOS_KERN_SYSLAT_H
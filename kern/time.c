@@ -0,0 +1,190 @@
+// Kernel time and timeouts for blocked environments.
+//
+// Time is counted in ticks of 1/HZ seconds, derived from the TSC so
+// that it keeps advancing while CPUs run without a periodic timer
+// interrupt.
+//
+// Each CPU keeps the timeouts it armed in its own timer wheel: an
+// array of WHEEL_SIZE lists, with a timeout due at tick t kept in slot
+// t % WHEEL_SIZE.  The CPU's timer interrupt only visits the slots for
+// ticks that have passed since the last one.  Timeouts further away
+// than WHEEL_SIZE ticks are simply passed over until they are due.
+
+#include <inc/error.h>
+#include <inc/assert.h>
+#include <inc/x86.h>
+
+#include <kern/env.h>
+#include <kern/cpu.h>
+#include <kern/futex.h>
+#include <kern/sched.h>
+#include <kern/time.h>
+
+#define WHEEL_SIZE	256
+
+struct TimerWheel {
+	struct Env *tw_slot[WHEEL_SIZE];
+	unsigned int tw_next;		// Next tick to process
+	int tw_count;			// Number of pending timeouts
+};
+
+// Set by lapic_init when it calibrates the LAPIC timer.
+uint64_t tsc_hz;
+
+static uint64_t tsc_boot;
+static uint64_t tsc_per_tick;
+
+static struct TimerWheel wheels[NCPU];
+
+void
+time_init(void)
+{
+	tsc_boot = read_tsc();
+	tsc_per_tick = tsc_hz / HZ;
+	if (tsc_per_tick == 0)
+		tsc_per_tick = 1;
+}
+
+unsigned int
+time_ticks(void)
+{
+	return (read_tsc() - tsc_boot) / tsc_per_tick;
+}
+
+// Nanoseconds since boot.
+uint64_t
+time_ns(void)
+{
+	return time_tsc_to_ns(read_tsc() - tsc_boot);
+}
+
+uint64_t
+time_ticks_to_ns(uint64_t nticks)
+{
+	return nticks * (1000000000 / HZ);
+}
+
+// Round a number of nanoseconds up to whole ticks.
+uint64_t
+time_ns_to_ticks(uint64_t ns)
+{
+	return (ns + 1000000000 / HZ - 1) / (1000000000 / HZ);
+}
+
+// Convert a TSC cycle count to nanoseconds, without overflowing for
+// counts of more than a few seconds.
+uint64_t
+time_tsc_to_ns(uint64_t tsc)
+{
+	if (tsc_hz == 0)
+		return 0;
+	return tsc / tsc_hz * 1000000000
+		+ tsc % tsc_hz * 1000000000 / tsc_hz;
+}
+
+static void
+timeout_unlink(struct Env *e)
+{
+	if (e->env_timeout_link)
+		e->env_timeout_link->env_timeout_prev = e->env_timeout_prev;
+	*e->env_timeout_prev = e->env_timeout_link;
+	e->env_timeout_link = NULL;
+	e->env_timeout_prev = NULL;
+	e->env_timeout_armed = 0;
+	wheels[e->env_timeout_cpu].tw_count--;
+}
+
+// Wake 'e' because its timed wait ran out.  Whatever it was waiting
+// for is abandoned.
+static void
+timeout_expire(struct Env *e)
+{
+	e->env_ipc_recving = 0;
+	futex_cancel(e);
+	e->env_tf.tf_regs.reg_eax = e->env_timeout_ret;
+	sched_wakeup(e);
+}
+
+// Expire the timeouts on this CPU's wheel whose deadline has passed.
+// Called from the timer interrupt.
+void
+time_poll(void)
+{
+	struct TimerWheel *w = &wheels[cpunum()];
+	struct Env *e, *next;
+	unsigned int now = time_ticks();
+	unsigned int n;
+
+	n = now - w->tw_next + 1;
+	if (n > WHEEL_SIZE)
+		n = WHEEL_SIZE;
+	for (; n > 0 && w->tw_count > 0; n--, w->tw_next++)
+		for (e = w->tw_slot[w->tw_next % WHEEL_SIZE]; e; e = next) {
+			next = e->env_timeout_link;
+			if ((int32_t) (e->env_timeout - now) <= 0) {
+				timeout_unlink(e);
+				timeout_expire(e);
+			}
+		}
+	w->tw_next = now + 1;
+}
+
+//
+// Arrange for 'e' to be woken after at least 'nticks' ticks, unless
+// timeout_cancel is called first.  The system call it is blocked in
+// then returns 'ret'.  The timeout goes on this CPU's wheel.
+//
+void
+timeout_add(struct Env *e, unsigned int nticks, int32_t ret)
+{
+	struct TimerWheel *w = &wheels[cpunum()];
+	struct Env **slot;
+
+	timeout_cancel(e);
+	// We may be partway through the current tick, so wait for one
+	// more tick boundary to be sure at least nticks pass.
+	e->env_timeout = time_ticks() + nticks + 1;
+	e->env_timeout_ret = ret;
+	e->env_timeout_cpu = cpunum();
+
+	slot = &w->tw_slot[e->env_timeout % WHEEL_SIZE];
+	e->env_timeout_link = *slot;
+	if (*slot)
+		(*slot)->env_timeout_prev = &e->env_timeout_link;
+	e->env_timeout_prev = slot;
+	*slot = e;
+	e->env_timeout_armed = 1;
+	w->tw_count++;
+}
+
+//
+// Cancel e's pending timeout, if any.
+//
+void
+timeout_cancel(struct Env *e)
+{
+	if (e->env_timeout_armed)
+		timeout_unlink(e);
+}
+
+//
+// Store the earliest deadline on this CPU's wheel in *deadline.
+// Returns 0 if there are no pending timeouts.
+//
+int
+timeout_next(unsigned int *deadline)
+{
+	struct TimerWheel *w = &wheels[cpunum()];
+	struct Env *e;
+	int i, found = 0;
+
+	if (w->tw_count == 0)
+		return 0;
+	for (i = 0; i < WHEEL_SIZE; i++)
+		for (e = w->tw_slot[i]; e; e = e->env_timeout_link)
+			if (!found || (int32_t) (e->env_timeout - *deadline) < 0) {
+				*deadline = e->env_timeout;
+				found = 1;
+			}
+	return found;
+}
@@ -0,0 +1,32 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_KERN_TIME_H
+#define JOS_KERN_TIME_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+// Timer interrupts per second.  Override at build time with 'make HZ=n'.
+#ifndef HZ
+#define HZ		100
+#endif
+
+struct Env;
+
+extern uint64_t tsc_hz;		// TSC cycles per second, measured at boot
+
+void	time_init(void);
+void	time_poll(void);
+unsigned int time_ticks(void);
+uint64_t time_ns(void);
+uint64_t time_ticks_to_ns(uint64_t nticks);
+uint64_t time_ns_to_ticks(uint64_t ns);
+uint64_t time_tsc_to_ns(uint64_t tsc);
+
+void	timeout_add(struct Env *e, unsigned int nticks, int32_t ret);
+void	timeout_cancel(struct Env *e);
+int	timeout_next(unsigned int *deadline);
+
+#endif	// !JOS_KERN_TIME_H
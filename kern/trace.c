@@ -0,0 +1,84 @@
+// Kernel event tracing.
+//
+// While tracing is on, context switches, syscalls, traps, page faults
+// and IPC are recorded with TSC timestamps in a fixed-size binary ring
+// per CPU.  Each ring is written only by its own CPU, and overwrites
+// its oldest events when full, so recording needs no lock and costs
+// far less than a cprintf through the polled console.
+//
+// trace_dump prints the rings in hex on the console, one event per
+// line; trace2json.py turns a captured console log into a Chrome
+// trace (chrome://tracing).
+
+#include <inc/assert.h>
+#include <inc/x86.h>
+
+#include <kern/cpu.h>
+#include <kern/time.h>
+#include <kern/trace.h>
+
+#define TRACE_NEVENT	1024	// Events kept per CPU
+
+struct TraceRing {
+	struct TraceEvent tr_buf[TRACE_NEVENT];
+	uint32_t tr_head;		// Events recorded since trace_start
+};
+
+volatile bool trace_enabled;
+
+static struct TraceRing rings[NCPU];
+
+void
+trace_record(int type, envid_t env, uint32_t arg0, uint32_t arg1)
+{
+	struct TraceRing *r = &rings[cpunum()];
+	struct TraceEvent *te = &r->tr_buf[r->tr_head % TRACE_NEVENT];
+
+	te->te_tsc = read_tsc();
+	te->te_type = type;
+	te->te_cpu = cpunum();
+	te->te_env = env;
+	te->te_arg[0] = arg0;
+	te->te_arg[1] = arg1;
+	r->tr_head++;
+}
+
+void
+trace_start(void)
+{
+	int i;
+
+	trace_enabled = 0;
+	for (i = 0; i < ncpu; i++)
+		rings[i].tr_head = 0;
+	trace_enabled = 1;
+}
+
+void
+trace_stop(void)
+{
+	trace_enabled = 0;
+}
+
+// Print every CPU's ring, oldest event first, between a header line
+// giving the TSC rate and a trailer line.
+void
+trace_dump(void)
+{
+	struct TraceRing *r;
+	uint32_t *w, i;
+	int cpu;
+
+	static_assert(sizeof(struct TraceEvent) == 6 * sizeof(uint32_t));
+	cprintf("trace: begin %d %u\n", ncpu, (uint32_t) (tsc_hz / 1000));
+	for (cpu = 0; cpu < ncpu; cpu++) {
+		r = &rings[cpu];
+		i = r->tr_head > TRACE_NEVENT ? r->tr_head - TRACE_NEVENT : 0;
+		for (; i < r->tr_head; i++) {
+			w = (uint32_t *) &r->tr_buf[i % TRACE_NEVENT];
+			cprintf("trace: %08x %08x %08x %08x %08x %08x\n",
+				w[0], w[1], w[2], w[3], w[4], w[5]);
+		}
+	}
+	cprintf("trace: end\n");
+}
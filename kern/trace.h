@@ -0,0 +1,28 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_KERN_TRACE_H
+#define JOS_KERN_TRACE_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+#include <inc/trace.h>
+
+extern volatile bool trace_enabled;
+
+void	trace_record(int type, envid_t env, uint32_t arg0, uint32_t arg1);
+void	trace_start(void);
+void	trace_stop(void);
+void	trace_dump(void);
+
+// Record an event if tracing is on.  Cheap enough to leave in hot
+// paths when it is off.
+static inline void
+trace_event(int type, envid_t env, uint32_t arg0, uint32_t arg1)
+{
+	if (trace_enabled)
+		trace_record(type, env, arg0, arg1);
+}
+
+#endif	// !JOS_KERN_TRACE_H
@@ -13,6 +13,9 @@
 #include <kern/picirq.h>
 #include <kern/cpu.h>
 #include <kern/spinlock.h>
+#include <kern/time.h>
+#include <kern/prof.h>
+#include <kern/trace.h>
 
 static struct Taskstate ts;
 
@@ -60,6 +63,8 @@ static const char *trapname(int trapno)
 		return excnames[trapno];
 	if (trapno == T_SYSCALL)
 		return "System call";
+	if (trapno == T_RESCHED)
+		return "Reschedule IPI";
 	if (trapno >= IRQ_OFFSET && trapno < IRQ_OFFSET + 16)
 		return "Hardware Interrupt";
 	return "(unknown trap)";
@@ -97,6 +102,8 @@ trap_init(void)
 	void MACHINE_CHECK();
 	void SIMD_FLOATING_POINT_EXCEPTION();
 	void SYSTEM_CALL();
+	void RESCHED();
+	void TLBFLUSH();
 	
 	SETGATE(idt[0], 0, GD_KT, &DIVIDE_ERROR, 0);
 	SETGATE(idt[1], 0, GD_KT, &DEBUG, 3);
@@ -117,6 +124,8 @@ trap_init(void)
 	SETGATE(idt[18], 0, GD_KT, &MACHINE_CHECK, 0);
 	SETGATE(idt[19], 0, GD_KT, &SIMD_FLOATING_POINT_EXCEPTION, 0);
 	SETGATE(idt[T_SYSCALL], 0, GD_KT, &SYSTEM_CALL, 3);
+	SETGATE(idt[T_RESCHED], 0, GD_KT, &RESCHED, 0);
+	SETGATE(idt[T_TLBFLUSH], 0, GD_KT, &TLBFLUSH, 0);
 
 	SETGATE(idt[IRQ_OFFSET+IRQ_TIMER], 0, GD_KT, &TIMER, 0);
 	SETGATE(idt[IRQ_OFFSET+IRQ_KBD], 0, GD_KT, &KBD, 0);
@@ -225,6 +234,10 @@ print_regs(struct PushRegs *regs)
 static void
 trap_dispatch(struct Trapframe *tf)
 {
+	if (tf->tf_trapno != T_SYSCALL)
+		trace_event(TE_TRAP, curenv ? curenv->env_id : 0,
+			    tf->tf_trapno, tf->tf_eip);
+
 	// Handle processor exceptions.
 	switch(tf->tf_trapno) {
 	case T_PGFLT:
@@ -237,10 +250,20 @@ trap_dispatch(struct Trapframe *tf)
 
 	case T_SYSCALL: {
 		struct PushRegs * regs = &tf->tf_regs;
+		uint32_t syscallno = regs->reg_eax;
+		trace_event(TE_SYSCALL, curenv->env_id, syscallno, 0);
+		if (syscallno < NSYSCALLS)
+			curenv->env_nsyscall[syscallno]++;
 		regs->reg_eax = syscall(regs->reg_eax, regs->reg_edx, regs->reg_ecx, 
 							regs->reg_ebx, regs->reg_edi, regs->reg_esi);
+		trace_event(TE_SYSRET, curenv->env_id, syscallno, regs->reg_eax);
 		break;
 	}
+	// The serial port has received characters or is ready to
+	// send more console output.
+	case IRQ_OFFSET + IRQ_SERIAL:
+		serial_intr();
+		return;
 	case IRQ_OFFSET + IRQ_SPURIOUS:
 		// Handle spurious interrupts
 		// The hardware sometimes raises these because of noise on the
@@ -253,7 +276,14 @@ trap_dispatch(struct Trapframe *tf)
 	// LAB 7: Your code here.
 	case IRQ_OFFSET + IRQ_TIMER:
 		lapic_eoi();
+		prof_sample(tf);
+		time_poll();
 		sched_yield(); 
+	// Another CPU made an environment runnable (or destroyed the
+	// one running here) and wants this CPU to reschedule.
+	case T_RESCHED:
+		lapic_eoi();
+		sched_yield();
 	default:
 		// Unexpected trap: The user process or the kernel has a bug.
 		print_trapframe(tf);
@@ -281,14 +311,18 @@ trap(struct Trapframe *tf)
 
 	// Re-acqurie the big kernel lock if we were halted in
 	// sched_yield()
-	if (xchg(&thiscpu->cpu_status, CPU_STARTED) == CPU_HALTED)
+	if (xchg(&thiscpu->cpu_status, CPU_STARTED) == CPU_HALTED) {
 		lock_kernel();
+		thiscpu->cpu_kicked = 0;
+	}
 	// Check that interrupts are disabled.  If this assertion
 	// fails, DO NOT be tempted to fix it by inserting a "cli" in
 	// the interrupt path.
 	assert(!(read_eflags() & FL_IF));
 
 	if ((tf->tf_cs & 3) == 3) {
+		uint64_t now = read_tsc();
+
 		lock_kernel();
 		// Trapped from user mode.
 		// Acquire the big kernel lock before doing any
@@ -296,6 +330,10 @@ trap(struct Trapframe *tf)
 		// LAB 5: Your code here.
 		assert(curenv);
 
+		// Charge the time since env_run to the environment.
+		curenv->env_cycles += now - thiscpu->cpu_run_start;
+		thiscpu->cpu_trap_start = now;
+
 		// Garbage collect if current enviroment is a zombie
 		if (curenv->env_status == ENV_DYING) {
 			env_free(curenv);
@@ -345,6 +383,12 @@ page_fault_handler(struct Trapframe *tf)
 
 	// We've already handled kernel-mode exceptions, so if we get here,
 	// the page fault happened in user mode.
+	trace_event(TE_PGFLT, curenv->env_id, fault_va, tf->tf_err);
+	if (tf->tf_err & FEC_WR) {
+		pte_t *pte = pgdir_walk(curenv->env_pgdir, (void *) fault_va, 0);
+		if (pte && (*pte & (PTE_P | PTE_COW)) == (PTE_P | PTE_COW))
+			curenv->env_cow_faults++;
+	}
 
 	// Call the environment's page fault upcall, if one exists.  Set up a
 	// page fault stack frame on the user exception stack (below
@@ -376,6 +420,7 @@ page_fault_handler(struct Trapframe *tf)
 	//   (the 'tf' variable points at 'curenv->env_tf').
 	struct Env *env = curenv;
 	if (env->env_pgfault_upcall) {
+		env->env_pgfaults_user++;
 		// set up a page fault stack frame on user exception stack
 		struct UTrapframe exception_stack;
 		exception_stack.utf_fault_va = fault_va;
@@ -403,6 +448,7 @@ page_fault_handler(struct Trapframe *tf)
 	}
 
 	// Destroy the environment that caused the fault.
+	env->env_pgfaults_kernel++;
 	cprintf("[%08x] user fault va %08x ip %08x\n",
 		curenv->env_id, fault_va, tf->tf_eip);
 	print_trapframe(tf);
@@ -0,0 +1,24 @@
+// Reporting for the bench_* microbenchmarks.
+
+#include <inc/lib.h>
+
+// Sort the 'n' per-operation cycle counts in 'cycles' and print
+//	bench: <name> n <n> min <min> median <median> p99 <p99>
+// for grade-bench to parse.
+void
+bench_report(const char *name, uint32_t *cycles, int n)
+{
+	uint32_t c;
+	int i, j;
+
+	if (n <= 0)
+		panic("bench %s: no samples", name);
+	for (i = 1; i < n; i++) {
+		c = cycles[i];
+		for (j = i; j > 0 && cycles[j - 1] > c; j--)
+			cycles[j] = cycles[j - 1];
+		cycles[j] = c;
+	}
+	cprintf("bench: %s n %d min %u median %u p99 %u\n",
+		name, n, cycles[0], cycles[n / 2], cycles[n * 99 / 100]);
+}
@@ -12,6 +12,18 @@ cputchar(int ch)
 	sys_cputs(&c, 1);
 }
 
+// Queue as much of 's' for the console as fits without waiting for
+// the serial port, and return the number of characters queued.
+size_t
+cputs_nowait(const char *s, size_t len)
+{
+	int r;
+
+	if ((r = sys_cputs_nowait(s, len)) < 0)
+		return 0;
+	return r;
+}
+
 int
 getchar(void)
 {
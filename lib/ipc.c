@@ -40,6 +40,47 @@ ipc_recv(envid_t *from_env_store, void *pg, int *perm_store)
 	return thisenv->env_ipc_value;
 }
 
+// Store the result of a receive that may fail with an expected error.
+static int
+ipc_recv_result(int r, envid_t *from_env_store, int *perm_store,
+		uint32_t *value_store)
+{
+	if (from_env_store)
+		*from_env_store = r < 0 ? 0 : thisenv->env_ipc_from;
+	if (perm_store)
+		*perm_store = r < 0 ? 0 : thisenv->env_ipc_perm;
+	if (value_store)
+		*value_store = r < 0 ? 0 : thisenv->env_ipc_value;
+	return r;
+}
+
+// Like ipc_recv, but return -E_WOULD_BLOCK immediately if no message is
+// waiting.  Since every 32-bit value is a valid message, the value is
+// stored in *value_store (if nonnull) and 0 is returned on success.
+int
+ipc_try_recv(envid_t *from_env_store, void *pg, int *perm_store,
+	     uint32_t *value_store)
+{
+	if (!pg) {
+		pg = (void *) UTOP;
+	}
+	return ipc_recv_result(sys_ipc_try_recv(pg), from_env_store,
+			       perm_store, value_store);
+}
+
+// Like ipc_try_recv, but wait up to 'nticks' timer ticks for a message
+// before giving up with -E_TIMEOUT.
+int
+ipc_recv_timed(envid_t *from_env_store, void *pg, int *perm_store,
+	       uint32_t *value_store, unsigned int nticks)
+{
+	if (!pg) {
+		pg = (void *) UTOP;
+	}
+	return ipc_recv_result(sys_ipc_recv_timed(pg, nticks), from_env_store,
+			       perm_store, value_store);
+}
+
 // Send 'val' (and 'pg' with 'perm', if 'pg' is nonnull) to 'toenv'.
 // This function keeps trying until it succeeds.
 // It should panic() on any error other than -E_IPC_NOT_RECV.
@@ -59,15 +100,108 @@ ipc_send(envid_t to_env, uint32_t val, void *pg, int perm)
 	}
 }
 
-// Find the first environment of the given type.  We'll use this to
+// Like ipc_recv, but accept up to 'npages' contiguous pages mapped
+// starting at 'pg'.  If 'npages_store' is nonnull, the number of pages
+// actually received is stored in *npages_store.
+int32_t
+ipc_recv_pages(envid_t *from_env_store, void *pg, size_t npages,
+	       size_t *npages_store, int *perm_store)
+{
+	if (!pg) {
+		pg = (void *) UTOP;
+	}
+	int recv_result = sys_ipc_recv_pages(pg, npages);
+	if (recv_result < 0) {
+		if (from_env_store)
+			*from_env_store = 0;
+		if (npages_store)
+			*npages_store = 0;
+		if (perm_store)
+			*perm_store = 0;
+		return recv_result;
+	}
+	if (from_env_store) {
+		*from_env_store = thisenv->env_ipc_from;
+	}
+	if (npages_store) {
+		*npages_store = thisenv->env_ipc_npages;
+	}
+	if (perm_store) {
+		*perm_store = thisenv->env_ipc_perm;
+	}
+
+	return thisenv->env_ipc_value;
+}
+
+// Send 'val' and the 'npages' pages starting at 'pg' to 'toenv' in a
+// single rendezvous.  Include IPC_MOVE in 'perm' to unmap the pages
+// from this environment instead of sharing them.
+// Panics on any error, like ipc_send.
+void
+ipc_send_pages(envid_t to_env, uint32_t val, void *pg, size_t npages, int perm)
+{
+	if (!pg) {
+		pg = (void *) UTOP;
+	}
+	if (sys_ipc_send_pages(to_env, val, pg, npages, perm) < 0) {
+		panic("Unexepected error in IPC send");
+	}
+}
+
+// Find an environment of the given type.  We'll use this to
 // find special environments.
 // Returns 0 if no such environment exists.
+//
+// The answer is cached; a cached envid is trusted as long as envs[]
+// shows it still alive with the right type, so a restarted server is
+// picked up with a single system call.
 envid_t
 ipc_find_env(enum EnvType type)
 {
-	int i;
-	for (i = 0; i < NENV; i++)
-		if (envs[i].env_type == type)
-			return envs[i].env_id;
-	return 0;
+	static envid_t cache[NENVTYPE];
+	const volatile struct Env *e;
+	envid_t id;
+
+	if ((unsigned) type >= NENVTYPE)
+		return 0;
+	if ((id = cache[type])) {
+		e = &envs[ENVX(id)];
+		if (e->env_id == id && e->env_status != ENV_FREE
+		    && e->env_type == type)
+			return id;
+	}
+	return cache[type] = sys_env_lookup_type(type);
+}
+
+// Send 'val' (and 'pg' with 'perm', if 'pg' is nonnull) on 'port',
+// blocking until the port's owner receives it.
+// Unlike ipc_send, errors are returned: a port can legitimately be
+// destroyed while its clients are still using it.
+int
+port_send(portid_t port, uint32_t val, void *pg, int perm)
+{
+	if (!pg) {
+		pg = (void *) UTOP;
+	}
+	return sys_port_send(port, val, pg, perm);
+}
+
+// Receive a message on any of the 'nports' ports in 'ports'.  When
+// several have senders waiting, the kernel picks the highest-priority
+// port.  The port the message arrived on is stored in *port_store (if
+// nonnull); the other results are as for ipc_try_recv.
+int
+port_recv(const portid_t *ports, int nports, portid_t *port_store,
+	  envid_t *from_env_store, void *pg, int *perm_store,
+	  uint32_t *value_store)
+{
+	int r;
+
+	if (!pg) {
+		pg = (void *) UTOP;
+	}
+	r = sys_port_recv(ports, nports, pg);
+	if (port_store)
+		*port_store = r < 0 ? 0 : thisenv->env_ipc_port;
+	return ipc_recv_result(r, from_env_store, perm_store, value_store);
 }
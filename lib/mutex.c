@@ -0,0 +1,35 @@
+// Sleeping mutexes for environments that share memory (e.g. sfork),
+// built on the sys_futex_wait/sys_futex_wake system calls.
+//
+// mu_state is 0 when the mutex is free, 1 when it is held and nobody
+// is waiting, and 2 when it is held and there may be waiters.  The
+// uncontended lock and unlock paths are a single xchg with no system
+// call; only contended paths enter the kernel.
+
+#include <inc/x86.h>
+#include <inc/lib.h>
+
+void
+mutex_init(struct Mutex *mu)
+{
+	mu->mu_state = 0;
+}
+
+void
+mutex_lock(struct Mutex *mu)
+{
+	if (xchg(&mu->mu_state, 1) == 0)
+		return;
+	// Contended: advertise a waiter and sleep until the holder
+	// releases the mutex.  Overwriting a 2 with the 1 above is
+	// harmless because we store 2 again before sleeping.
+	while (xchg(&mu->mu_state, 2) != 0)
+		sys_futex_wait((uint32_t *) &mu->mu_state, 2);
+}
+
+void
+mutex_unlock(struct Mutex *mu)
+{
+	if (xchg(&mu->mu_state, 0) == 2)
+		sys_futex_wake((uint32_t *) &mu->mu_state, 1);
+}
@@ -28,6 +28,10 @@ static const char * const error_string[MAXERROR] =
 	[E_FAULT]	= "segmentation fault",
 	[E_IPC_NOT_RECV]= "env is not recving",
 	[E_EOF]		= "unexpected end of file",
+	[E_WOULD_BLOCK]	= "operation would block",
+	[E_TIMEOUT]	= "timed out",
+	[E_BAD_PORT]	= "bad port",
+	[E_NO_FREE_PORT] = "out of ports",
 };
 
 /*
@@ -111,3 +111,144 @@ sys_ipc_recv(void *dstva)
 	return syscall(SYS_ipc_recv, 1, (uint32_t)dstva, 0, 0, 0, 0);
 }
 
+
+int
+sys_ipc_send_pages(envid_t envid, uint32_t value, void *srcva, size_t npages, int perm)
+{
+	return syscall(SYS_ipc_send_pages, 0, envid, value, (uint32_t) srcva, npages, perm);
+}
+
+int
+sys_ipc_recv_pages(void *dstva, size_t npages)
+{
+	return syscall(SYS_ipc_recv_pages, 1, (uint32_t) dstva, npages, 0, 0, 0);
+}
+
+int
+sys_ipc_try_recv(void *dstva)
+{
+	return syscall(SYS_ipc_try_recv, 0, (uint32_t) dstva, 0, 0, 0, 0);
+}
+
+int
+sys_ipc_recv_timed(void *dstva, unsigned int nticks)
+{
+	return syscall(SYS_ipc_recv_timed, 0, (uint32_t) dstva, nticks, 0, 0, 0);
+}
+
+int
+sys_futex_wait(uint32_t *va, uint32_t expected)
+{
+	return syscall(SYS_futex_wait, 0, (uint32_t) va, expected, 0, 0, 0);
+}
+
+int
+sys_futex_wake(uint32_t *va, int n)
+{
+	return syscall(SYS_futex_wake, 0, (uint32_t) va, n, 0, 0, 0);
+}
+
+portid_t
+sys_port_create(int priority)
+{
+	return syscall(SYS_port_create, 0, priority, 0, 0, 0, 0);
+}
+
+int
+sys_port_grant(portid_t port, envid_t envid)
+{
+	return syscall(SYS_port_grant, 1, port, envid, 0, 0, 0);
+}
+
+int
+sys_port_destroy(portid_t port)
+{
+	return syscall(SYS_port_destroy, 1, port, 0, 0, 0, 0);
+}
+
+int
+sys_port_send(portid_t port, uint32_t value, void *srcva, int perm)
+{
+	return syscall(SYS_port_send, 0, port, value, (uint32_t) srcva, perm, 0);
+}
+
+int
+sys_port_recv(const portid_t *ports, int nports, void *dstva)
+{
+	return syscall(SYS_port_recv, 0, (uint32_t) ports, nports, (uint32_t) dstva, 0, 0);
+}
+
+envid_t
+sys_env_lookup_type(enum EnvType type)
+{
+	return syscall(SYS_env_lookup_type, 0, type, 0, 0, 0, 0);
+}
+
+// The kernel returns the 64-bit time in %edx:%eax, which the generic
+// syscall() above cannot express.
+uint64_t
+sys_time_ns(void)
+{
+	uint64_t ns;
+
+	asm volatile("int %1\n"
+		     : "=A" (ns)
+		     : "i" (T_SYSCALL),
+		       "a" (SYS_time_ns)
+		     : "cc", "memory");
+	return ns;
+}
+
+int
+sys_env_set_priority(envid_t envid, int priority, int nice)
+{
+	return syscall(SYS_env_set_priority, 1, envid, priority, nice, 0, 0);
+}
+
+int
+sys_env_set_tickets(envid_t envid, uint32_t tickets)
+{
+	return syscall(SYS_env_set_tickets, 1, envid, tickets, 0, 0, 0);
+}
+
+int
+sys_env_set_affinity(envid_t envid, uint32_t cpumask)
+{
+	return syscall(SYS_env_set_affinity, 1, envid, cpumask, 0, 0, 0);
+}
+
+int
+sys_prof(int op, struct ProfHot *buf, size_t n)
+{
+	return syscall(SYS_prof, 0, op, (uint32_t) buf, n, 0, 0);
+}
+
+int
+sys_trace(int op)
+{
+	return syscall(SYS_trace, 0, op, 0, 0, 0, 0);
+}
+
+int
+sys_klog_set_console(int level)
+{
+	return syscall(SYS_klog_set_console, 0, level, 0, 0, 0, 0);
+}
+
+int
+sys_cputs_nowait(const char *s, size_t len)
+{
+	return syscall(SYS_cputs_nowait, 0, (uint32_t) s, len, 0, 0, 0);
+}
+
+int
+sys_syslat(int op, uint32_t syscallno, uint32_t *hist)
+{
+	return syscall(SYS_syslat, 0, op, syscallno, (uint32_t) hist, 0, 0);
+}
+
+int
+sys_sleep(uint64_t ns)
+{
+	return syscall(SYS_sleep, 0, (uint32_t) ns, ns >> 32, 0, 0, 0);
+}
@@ -0,0 +1,108 @@
+#!/usr/bin/env python
+
+"""Convert a JOS event trace dump to Chrome trace JSON.
+
+Capture the console output of 'trace dump' (monitor) or
+sys_trace(TRACE_DUMP), e.g. from 'make qemu-nox' or jos.out, and run
+
+    python trace2json.py jos.out > trace.json
+
+then load trace.json in chrome://tracing or https://ui.perfetto.dev.
+Each CPU is shown as a thread; env runs and syscalls are slices, and
+traps, page faults and IPC are instant events.
+"""
+
+from __future__ import print_function
+
+import sys, re, json, struct
+
+TE_RUN, TE_IDLE, TE_SYSCALL, TE_SYSRET, TE_TRAP, TE_PGFLT, \
+    TE_IPC_SEND, TE_IPC_RECV = range(1, 9)
+
+def read_dump(f):
+    """Return (tsc_khz, events) for the last complete dump in f."""
+    tsc_khz, events, cur = None, None, None
+    for line in f:
+        m = re.search(r"trace: (.*)", line)
+        if not m:
+            continue
+        words = m.group(1).split()
+        if words[0] == "begin":
+            tsc_khz, cur = int(words[2]), []
+        elif words[0] == "end":
+            if cur is not None:
+                events = cur
+            cur = None
+        elif cur is not None and len(words) == 6:
+            raw = struct.pack("<6I", *[int(w, 16) for w in words])
+            tsc, typ, cpu, env, a0, a1 = struct.unpack("<QHHiII", raw)
+            cur.append((tsc, typ, cpu, env, a0, a1))
+    if events is None:
+        sys.exit("no complete trace dump found")
+    return tsc_khz, sorted(events)
+
+def convert(tsc_khz, events):
+    out = []
+    t0 = events[0][0] if events else 0
+    us = lambda tsc: (tsc - t0) * 1000.0 / tsc_khz
+    running = {}        # cpu -> (env, start tsc)
+    insys = {}          # cpu -> (syscall number, start tsc)
+
+    def slice(cpu, name, start, end, cat, args=None):
+        out.append({"name": name, "cat": cat, "ph": "X", "pid": 0,
+                    "tid": cpu, "ts": us(start), "dur": us(end) - us(start),
+                    "args": args or {}})
+
+    def instant(cpu, name, tsc, args):
+        out.append({"name": name, "cat": "event", "ph": "i", "s": "t",
+                    "pid": 0, "tid": cpu, "ts": us(tsc), "args": args})
+
+    def end_run(cpu, tsc):
+        if cpu in insys:
+            no, start = insys.pop(cpu)
+            slice(cpu, "syscall %d (blocked)" % no, start, tsc, "syscall")
+        if cpu in running:
+            env, start = running.pop(cpu)
+            slice(cpu, "env %05x" % env, start, tsc, "env")
+
+    for tsc, typ, cpu, env, a0, a1 in events:
+        if typ == TE_RUN:
+            end_run(cpu, tsc)
+            running[cpu] = (env, tsc)
+        elif typ == TE_IDLE:
+            end_run(cpu, tsc)
+        elif typ == TE_SYSCALL:
+            insys[cpu] = (a0, tsc)
+        elif typ == TE_SYSRET:
+            if cpu in insys:
+                no, start = insys.pop(cpu)
+                slice(cpu, "syscall %d" % no, start, tsc, "syscall",
+                      {"ret": struct.unpack("<i", struct.pack("<I", a1))[0]})
+        elif typ == TE_TRAP:
+            instant(cpu, "trap %d" % a0, tsc,
+                    {"env": "%05x" % env, "eip": "%08x" % a1})
+        elif typ == TE_PGFLT:
+            instant(cpu, "page fault", tsc,
+                    {"env": "%05x" % env, "va": "%08x" % a0,
+                     "err": a1})
+        elif typ == TE_IPC_SEND:
+            instant(cpu, "ipc send", tsc,
+                    {"from": "%05x" % env, "to": "%05x" % a0, "value": a1})
+        elif typ == TE_IPC_RECV:
+            instant(cpu, "ipc recv", tsc, {"env": "%05x" % env})
+    if events:
+        for cpu in list(running):
+            end_run(cpu, events[-1][0])
+    for cpu in sorted(set(e[2] for e in events)):
+        out.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": cpu,
+                    "args": {"name": "CPU %d" % cpu}})
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+def main():
+    f = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    tsc_khz, events = read_dump(f)
+    json.dump(convert(tsc_khz, events), sys.stdout, indent=1)
+    print()
+
+if __name__ == "__main__":
+    main()
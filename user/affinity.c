@@ -0,0 +1,48 @@
+// Test that an IPC server/client pair can be pinned to separate CPUs
+// and stays there.
+
+#include <inc/lib.h>
+
+#define NROUND	100
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	uint32_t i;
+	int r;
+
+	if ((r = sys_env_set_affinity(0, 0)) != -E_INVAL)
+		panic("empty affinity mask: got %e", r);
+	if ((r = sys_env_set_affinity(0, 1 << 0)) < 0)
+		panic("sys_env_set_affinity: %e", r);
+
+	if ((who = fork()) == 0) {
+		// Inherited CPU 0 from the parent; wait to be moved.
+		while (thisenv->env_cpumask != (1 << 1)) {
+			if (thisenv->env_cpumask != (1 << 0))
+				panic("child mask %x", thisenv->env_cpumask);
+			sys_yield();
+		}
+		sys_yield();
+		for (i = 0; i < NROUND; i++) {
+			if (ipc_recv(&who, 0, 0) != i)
+				panic("child got wrong value");
+			if (thisenv->env_cpunum != 1)
+				panic("child ran on CPU %d", thisenv->env_cpunum);
+			ipc_send(who, i, 0, 0);
+		}
+		return;
+	}
+
+	if ((r = sys_env_set_affinity(who, 1 << 1)) < 0)
+		panic("sys_env_set_affinity: %e", r);
+	for (i = 0; i < NROUND; i++) {
+		ipc_send(who, i, 0, 0);
+		if (ipc_recv(0, 0, 0) != i)
+			panic("parent got wrong value");
+		if (thisenv->env_cpunum != 0)
+			panic("parent ran on CPU %d", thisenv->env_cpunum);
+	}
+	cprintf("affinity ok\n");
+}
@@ -0,0 +1,37 @@
+// Benchmark a copy-on-write fault: the page fault upcall, copying the
+// page and remapping it.
+
+#include <inc/lib.h>
+#include <inc/x86.h>
+
+#define NITER	256
+
+static uint32_t cycles[NITER];
+// Never read, so volatile keeps the compiler from dropping the stores.
+static volatile char buf[NITER * PGSIZE] __attribute__((aligned(PGSIZE)));
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	uint64_t t;
+	int i;
+
+	for (i = 0; i < NITER; i++)
+		buf[i * PGSIZE] = 1;
+	if ((who = fork()) < 0)
+		panic("fork: %e", who);
+	if (who != 0)
+		return;
+
+	// Take the copy-on-write faults on 'cycles' before timing.
+	memset(cycles, 0, sizeof(cycles));
+	for (i = 0; i < NITER; i++) {
+		t = read_tsc();
+		asm volatile("" ::: "memory");
+		buf[i * PGSIZE] = 2;
+		asm volatile("" ::: "memory");
+		cycles[i] = read_tsc() - t;
+	}
+	bench_report("cowfault", cycles, NITER);
+}
@@ -0,0 +1,38 @@
+// Benchmark a context switch between two environments that take turns
+// yielding the same CPU.
+
+#include <inc/lib.h>
+#include <inc/x86.h>
+
+#define NITER	1000
+
+static uint32_t cycles[NITER];
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	uint64_t t;
+	int i, r;
+
+	// Keep both environments on CPU 0 so each yield switches
+	// between them.
+	if ((r = sys_env_set_affinity(0, 1 << 0)) < 0)
+		panic("sys_env_set_affinity: %e", r);
+	if ((who = fork()) < 0)
+		panic("fork: %e", who);
+	if (who == 0)
+		while (1)
+			sys_yield();
+
+	// Take the copy-on-write faults on 'cycles' before timing.
+	memset(cycles, 0, sizeof(cycles));
+	for (i = 0; i < NITER; i++) {
+		t = read_tsc();
+		sys_yield();
+		// Each yield switches to the child and back.
+		cycles[i] = (read_tsc() - t) / 2;
+	}
+	sys_env_destroy(who);
+	bench_report("ctxswitch", cycles, NITER);
+}
@@ -0,0 +1,31 @@
+// Benchmark fork() of a small environment.
+
+#include <inc/lib.h>
+#include <inc/x86.h>
+
+#define NITER	50
+
+static uint32_t cycles[NITER];
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	uint64_t t;
+	int i;
+
+	for (i = 0; i < NITER; i++) {
+		t = read_tsc();
+		if ((who = fork()) < 0)
+			panic("fork: %e", who);
+		if (who == 0)
+			return;
+		cycles[i] = read_tsc() - t;
+
+		// Let the child exit so environments don't run out.
+		while (envs[ENVX(who)].env_id == who
+		       && envs[ENVX(who)].env_status != ENV_FREE)
+			sys_yield();
+	}
+	bench_report("fork", cycles, NITER);
+}
@@ -0,0 +1,34 @@
+// Benchmark the round trip time of an IPC message to another
+// environment and back.
+
+#include <inc/lib.h>
+#include <inc/x86.h>
+
+#define NITER	1000
+
+static uint32_t cycles[NITER];
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	uint64_t t;
+	int i;
+
+	if ((who = fork()) == 0) {
+		who = thisenv->env_parent_id;
+		while (1)
+			ipc_send(who, ipc_recv(0, 0, 0), 0, 0);
+	}
+
+	// Take the copy-on-write faults on 'cycles' before timing.
+	memset(cycles, 0, sizeof(cycles));
+	for (i = 0; i < NITER; i++) {
+		t = read_tsc();
+		ipc_send(who, i, 0, 0);
+		ipc_recv(0, 0, 0);
+		cycles[i] = read_tsc() - t;
+	}
+	sys_env_destroy(who);
+	bench_report("ipc_rtt", cycles, NITER);
+}
@@ -0,0 +1,36 @@
+// Benchmark mapping a page at a second address and unmapping it.
+
+#include <inc/lib.h>
+#include <inc/x86.h>
+
+#define NITER	1000
+
+#define SRCVA	((char *) 0x10000000)
+#define DSTVA	((char *) 0x10001000)
+
+static uint32_t map_cycles[NITER];
+static uint32_t unmap_cycles[NITER];
+
+void
+umain(int argc, char **argv)
+{
+	uint64_t t;
+	int i, r;
+
+	if ((r = sys_page_alloc(0, SRCVA, PTE_P | PTE_U | PTE_W)) < 0)
+		panic("sys_page_alloc: %e", r);
+	for (i = 0; i < NITER; i++) {
+		t = read_tsc();
+		if ((r = sys_page_map(0, SRCVA, 0, DSTVA,
+				      PTE_P | PTE_U | PTE_W)) < 0)
+			panic("sys_page_map: %e", r);
+		map_cycles[i] = read_tsc() - t;
+
+		t = read_tsc();
+		if ((r = sys_page_unmap(0, DSTVA)) < 0)
+			panic("sys_page_unmap: %e", r);
+		unmap_cycles[i] = read_tsc() - t;
+	}
+	bench_report("pagemap", map_cycles, NITER);
+	bench_report("pageunmap", unmap_cycles, NITER);
+}
@@ -0,0 +1,22 @@
+// Benchmark the cost of a null system call.
+
+#include <inc/lib.h>
+#include <inc/x86.h>
+
+#define NITER	1000
+
+static uint32_t cycles[NITER];
+
+void
+umain(int argc, char **argv)
+{
+	uint64_t t;
+	int i;
+
+	for (i = 0; i < NITER; i++) {
+		t = read_tsc();
+		sys_getenvid();
+		cycles[i] = read_tsc() - t;
+	}
+	bench_report("syscall", cycles, NITER);
+}
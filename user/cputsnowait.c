@@ -0,0 +1,26 @@
+// Test that cputs_nowait queues output without waiting, and that
+// retrying gets all of it out.
+
+#include <inc/lib.h>
+
+#define NLINE	200
+
+void
+umain(int argc, char **argv)
+{
+	static char buf[NLINE * 16];
+	size_t len = 0, off, n;
+	int i;
+
+	for (i = 0; i < NLINE; i++)
+		len += snprintf(buf + len, sizeof(buf) - len, "nowait %05d\n", i);
+
+	for (off = 0; off < len; off += n) {
+		n = cputs_nowait(buf + off, len - off);
+		if (n > len - off)
+			panic("queued %d of %d bytes", n, len - off);
+		if (n == 0)
+			sys_yield();
+	}
+	cprintf("cputs_nowait ok\n");
+}
@@ -0,0 +1,46 @@
+// Test the per-environment statistics the kernel keeps in envs[].
+
+#include <inc/lib.h>
+
+#define NCALL	10
+
+int counter = 1;
+
+void
+umain(int argc, char **argv)
+{
+	const volatile struct Env *e;
+	envid_t who;
+	int i, r;
+
+	if ((who = fork()) == 0) {
+		// Copy-on-write fault, some system calls, one message.
+		counter++;
+		for (i = 0; i < NCALL; i++)
+			sys_getenvid();
+		ipc_send(thisenv->env_parent_id, counter, 0, 0);
+		ipc_recv(0, 0, 0);
+		return;
+	}
+
+	if ((r = ipc_recv(0, 0, 0)) != 2)
+		panic("got %d from child", r);
+	e = &envs[ENVX(who)];
+	if (e->env_nsyscall[SYS_getenvid] < NCALL)
+		panic("child made %u getenvid calls",
+		      e->env_nsyscall[SYS_getenvid]);
+	if (e->env_cow_faults < 1 || e->env_pgfaults_user < e->env_cow_faults)
+		panic("child took %u cow faults, %u user faults",
+		      e->env_cow_faults, e->env_pgfaults_user);
+	if (e->env_ipc_sent != 1 || thisenv->env_ipc_recvd != 1)
+		panic("child sent %u messages, parent received %u",
+		      e->env_ipc_sent, thisenv->env_ipc_recvd);
+	if (e->env_switches < 1 || e->env_kcycles == 0)
+		panic("child switched to %u times, %llu kernel cycles",
+		      e->env_switches, e->env_kcycles);
+	if (thisenv->env_pgfaults_kernel != 0)
+		panic("parent took %u unhandled faults",
+		      thisenv->env_pgfaults_kernel);
+	sys_env_destroy(who);
+	cprintf("envstat ok\n");
+}
@@ -0,0 +1,47 @@
+// Fairness benchmark for the stride scheduler (make SCHED_STRIDE=1).
+// Run CPU-bound children holding different numbers of tickets and
+// report the CPU share each asked for against the share it got.
+
+#include <inc/lib.h>
+
+#define NCHILD	3
+
+static const uint32_t tickets[NCHILD] = { 100, 200, 300 };
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who[NCHILD];
+	uint64_t cycles[NCHILD], total = 0;
+	uint32_t total_tickets = 0;
+	int i, want, got, ok = 1;
+
+	for (i = 0; i < NCHILD; i++) {
+		if ((who[i] = fork()) == 0)
+			while (1)
+				/* do nothing */;
+		sys_env_set_tickets(who[i], tickets[i]);
+		total_tickets += tickets[i];
+	}
+	sys_sleep(500 * 1000000ULL);
+
+	for (i = 0; i < NCHILD; i++) {
+		cycles[i] = envs[ENVX(who[i])].env_cycles;
+		total += cycles[i];
+	}
+	for (i = 0; i < NCHILD; i++)
+		sys_env_destroy(who[i]);
+	if (total == 0)
+		panic("children never ran");
+
+	for (i = 0; i < NCHILD; i++) {
+		want = tickets[i] * 1000 / total_tickets;
+		got = cycles[i] * 1000 / total;
+		cprintf("env %08x: %d tickets, requested %d.%d%%, got %d.%d%%\n",
+			who[i], tickets[i], want / 10, want % 10,
+			got / 10, got % 10);
+		if (got < want - 50 || got > want + 50)
+			ok = 0;
+	}
+	cprintf(ok ? "shares match tickets\n" : "shares do not match tickets\n");
+}
@@ -0,0 +1,45 @@
+// Test futex wait/wake between sfork'd environments sharing memory.
+// The children contend for a futex-based mutex and the parent sleeps
+// on a shared counter until all of them have finished.
+
+#include <inc/x86.h>
+#include <inc/lib.h>
+
+#define NCHILD	4
+#define NITER	200
+
+struct Mutex mu;
+volatile uint32_t counter;
+volatile uint32_t done;
+
+void
+umain(int argc, char **argv)
+{
+	int i, j;
+	uint32_t d;
+
+	mutex_init(&mu);
+	for (i = 0; i < NCHILD; i++) {
+		if (sfork() == 0) {
+			for (j = 0; j < NITER; j++) {
+				mutex_lock(&mu);
+				d = counter;
+				sys_yield();
+				counter = d + 1;
+				mutex_unlock(&mu);
+			}
+			mutex_lock(&mu);
+			done++;
+			mutex_unlock(&mu);
+			sys_futex_wake((uint32_t *) &done, 1);
+			return;
+		}
+	}
+
+	while ((d = done) != NCHILD)
+		sys_futex_wait((uint32_t *) &done, d);
+
+	if (counter != NCHILD * NITER)
+		panic("futex mutex lost updates (counter is %d)", counter);
+	cprintf("futex test passed\n");
+}
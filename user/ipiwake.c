@@ -0,0 +1,42 @@
+// Test that an env blocked on a halted CPU wakes promptly when an env
+// on another CPU sends it a message.
+
+#include <inc/lib.h>
+
+#define MS	1000000ULL
+#define NROUND	5
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	uint64_t t1, t2;
+	uint32_t i;
+	int r;
+
+	if ((r = sys_env_set_affinity(0, 1 << 0)) < 0)
+		panic("sys_env_set_affinity: %e", r);
+	if ((who = fork()) == 0) {
+		who = thisenv->env_parent_id;
+		while (1)
+			ipc_send(who, ipc_recv(0, 0, 0), 0, 0);
+	}
+	if ((r = sys_env_set_affinity(who, 1 << 1)) < 0)
+		panic("sys_env_set_affinity: %e", r);
+
+	for (i = 0; i < NROUND; i++) {
+		// Give CPU 1 time to halt with its timer stopped, so
+		// only the reschedule IPI can wake it.
+		sys_sleep(10 * MS);
+		t1 = sys_time_ns();
+		ipc_send(who, i, 0, 0);
+		if (ipc_recv(0, 0, 0) != i)
+			panic("got wrong value");
+		t2 = sys_time_ns();
+		if (t2 - t1 > 50 * MS)
+			panic("round trip took %u us",
+			      (uint32_t) ((t2 - t1) / 1000));
+	}
+	sys_env_destroy(who);
+	cprintf("ipiwake ok\n");
+}
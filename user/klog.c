@@ -0,0 +1,52 @@
+// Test the kernel log: env lifecycle messages land in the log mapped
+// at ULOG even when they are kept off the console.
+
+#include <inc/lib.h>
+
+// Is there a log message ending in 'what'?
+static bool
+logged(const char *what)
+{
+	const volatile struct KLogRecord *kr;
+	char text[KLOG_TEXTLEN];
+	uint32_t seq, n, len = strlen(what);
+
+	seq = klog.kl_next > KLOG_NREC ? klog.kl_next - KLOG_NREC : 1;
+	for (; seq < klog.kl_next; seq++) {
+		kr = &klog.kl_rec[seq % KLOG_NREC];
+		n = MIN(kr->kr_len, KLOG_TEXTLEN - 1);
+		memmove(text, (const void *) kr->kr_text, n);
+		text[n] = 0;
+		if (kr->kr_seq == seq && n >= len
+		    && strcmp(text + n - len, what) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+void
+umain(int argc, char **argv)
+{
+	char msg[32];
+	envid_t who;
+	int old;
+
+	if (sys_klog_set_console(NKLOGLEVEL) != -E_INVAL)
+		panic("bad level accepted");
+	if ((old = sys_klog_set_console(KLOG_WARN)) < 0)
+		panic("sys_klog_set_console: %e", old);
+
+	if ((who = fork()) == 0)
+		return;
+	while (envs[ENVX(who)].env_status != ENV_FREE)
+		sys_yield();
+	sys_klog_set_console(old);
+
+	snprintf(msg, sizeof(msg), "new env %08x", who);
+	if (!logged(msg))
+		panic("'%s' not logged", msg);
+	snprintf(msg, sizeof(msg), "free env %08x", who);
+	if (!logged(msg))
+		panic("'%s' not logged", msg);
+	cprintf("klog ok\n");
+}
@@ -0,0 +1,84 @@
+// Test IPC ports: selective receive and priority order.
+
+#include <inc/lib.h>
+
+static portid_t lo, hi;
+
+static envid_t
+sender(portid_t port, uint32_t first, int n)
+{
+	envid_t who;
+	int i, r;
+
+	if ((who = fork()) != 0)
+		return who;
+	for (i = 0; i < n; i++)
+		if ((r = port_send(port, first + i, 0, 0)) < 0)
+			panic("port_send: %e", r);
+	exit();
+	return 0;
+}
+
+// Wait until 'who' is blocked sending.
+static void
+wait_blocked(envid_t who)
+{
+	while (envs[ENVX(who)].env_status != ENV_NOT_RUNNABLE)
+		sys_yield();
+}
+
+static uint32_t
+recv(const portid_t *ports, int n, portid_t expect_port)
+{
+	portid_t port;
+	uint32_t val;
+	int r;
+
+	if ((r = port_recv(ports, n, &port, 0, 0, 0, &val)) < 0)
+		panic("port_recv: %e", r);
+	if (port != expect_port)
+		panic("got %d on port %08x, expected port %08x",
+		      val, port, expect_port);
+	return val;
+}
+
+void
+umain(int argc, char **argv)
+{
+	portid_t both[2];
+	envid_t a, b;
+	int r;
+
+	if ((lo = sys_port_create(1)) < 0)
+		panic("sys_port_create: %e", lo);
+	if ((hi = sys_port_create(10)) < 0)
+		panic("sys_port_create: %e", hi);
+	sys_port_grant(lo, 0);
+	sys_port_grant(hi, 0);
+
+	a = sender(lo, 100, 2);
+	b = sender(hi, 200, 1);
+	wait_blocked(a);
+	wait_blocked(b);
+
+	// Only listen on the low-priority port.
+	if (recv(&lo, 1, lo) != 100)
+		panic("wrong value on low port");
+	cprintf("selective receive ok\n");
+
+	// Both ports have senders: the high-priority one goes first even
+	// though it is listed second.
+	wait_blocked(a);
+	both[0] = lo;
+	both[1] = hi;
+	if (recv(both, 2, hi) != 200)
+		panic("wrong value on high port");
+	if (recv(both, 2, lo) != 101)
+		panic("wrong value on low port");
+	cprintf("priority receive ok\n");
+
+	sys_port_destroy(lo);
+	if ((r = port_send(lo, 0, 0, 0)) != -E_BAD_PORT)
+		panic("send on destroyed port: %e", r);
+	cprintf("destroyed port rejected\n");
+}
@@ -0,0 +1,41 @@
+// Test priority scheduling: of two CPU-bound children, the one with
+// the higher priority should get more CPU time, but aging should keep
+// the other one from starving.
+
+#include <inc/lib.h>
+
+static envid_t
+spinner(int priority)
+{
+	envid_t who;
+
+	if ((who = fork()) == 0)
+		while (1)
+			/* do nothing */;
+	sys_env_set_priority(who, priority, 0);
+	return who;
+}
+
+void
+umain(int argc, char **argv)
+{
+	envid_t hi, lo;
+	uint64_t hi_cycles, lo_cycles;
+
+	sys_env_set_priority(0, ENV_PRIO_MAX, 0);
+	hi = spinner(ENV_PRIO_DEFAULT + 8);
+	lo = spinner(ENV_PRIO_DEFAULT);
+	sys_sleep(200 * 1000000);
+
+	hi_cycles = envs[ENVX(hi)].env_cycles;
+	lo_cycles = envs[ENVX(lo)].env_cycles;
+	sys_env_destroy(hi);
+	sys_env_destroy(lo);
+
+	if (lo_cycles == 0)
+		panic("low-priority env starved");
+	if (hi_cycles <= 2 * lo_cycles)
+		panic("high-priority env got %u Mcycles, low got %u Mcycles",
+		      (uint32_t) (hi_cycles >> 20), (uint32_t) (lo_cycles >> 20));
+	cprintf("priority ok\n");
+}
@@ -0,0 +1,48 @@
+// Test that the profiler finds a user-mode hot loop.
+
+#include <inc/lib.h>
+
+#define NHOT	16
+
+static volatile uint32_t counter;
+
+static void
+spin(uint64_t ns)
+{
+	uint64_t end = sys_time_ns() + ns;
+
+	while (sys_time_ns() < end)
+		for (counter = 0; counter < 100000; counter++)
+			;
+}
+
+void
+umain(int argc, char **argv)
+{
+	struct ProfHot hot[NHOT];
+	int i, n, r;
+	uint32_t mine = 0;
+
+	if ((r = sys_prof(-1, 0, 0)) != -E_INVAL)
+		panic("bad op: got %e", r);
+
+	sys_prof(PROF_START, 0, 0);
+	spin(200 * 1000000);
+	sys_prof(PROF_STOP, 0, 0);
+
+	if ((n = sys_prof(PROF_READ, hot, NHOT)) < 0)
+		panic("sys_prof: %e", n);
+	for (i = 0; i < n; i++) {
+		if (i > 0 && hot[i].ph_count > hot[i - 1].ph_count)
+			panic("hot spots out of order");
+		if (hot[i].ph_env == thisenv->env_id) {
+			if (hot[i].ph_eip >= UTOP)
+				panic("user sample at %08x", hot[i].ph_eip);
+			mine += hot[i].ph_count;
+		}
+	}
+	if (mine < 5)
+		panic("only %d samples in the hot loop", mine);
+	sys_prof(PROF_REPORT, 0, 5);
+	cprintf("prof ok\n");
+}
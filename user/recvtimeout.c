@@ -0,0 +1,30 @@
+// Test non-blocking and timed IPC receive.
+
+#include <inc/lib.h>
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who, from;
+	uint32_t val;
+	int r;
+
+	if ((r = ipc_try_recv(&from, 0, 0, &val)) != -E_WOULD_BLOCK)
+		panic("ipc_try_recv with no sender: %e", r);
+	cprintf("try_recv would block\n");
+
+	if ((r = ipc_recv_timed(&from, 0, 0, &val, 5)) != -E_TIMEOUT)
+		panic("ipc_recv_timed with no sender: %e", r);
+	cprintf("recv_timed timed out\n");
+
+	if ((who = fork()) == 0) {
+		sys_yield();
+		ipc_send(thisenv->env_parent_id, 0x1234, 0, 0);
+		return;
+	}
+	if ((r = ipc_recv_timed(&from, 0, 0, &val, 1000)) < 0)
+		panic("ipc_recv_timed: %e", r);
+	if (from != who || val != 0x1234)
+		panic("received %08x from %08x", val, from);
+	cprintf("recv_timed got %x\n", val);
+}
@@ -0,0 +1,37 @@
+// Test transferring a range of pages in one IPC, with move semantics.
+
+#include <inc/lib.h>
+
+#define NPAGES		16
+#define SRC_ADDR	((char *) 0xa00000)
+#define DST_ADDR	((char *) 0xc00000)
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	size_t i, n;
+	int perm;
+
+	if ((who = fork()) == 0) {
+		// Child: offer a window twice as large as what is sent.
+		ipc_recv_pages(&who, DST_ADDR, 2 * NPAGES, &n, &perm);
+		if (n != NPAGES)
+			panic("received %d pages, expected %d", n, NPAGES);
+		for (i = 0; i < NPAGES; i++)
+			if (DST_ADDR[i * PGSIZE] != (char) i)
+				panic("page %d has wrong contents", i);
+		cprintf("child received %d pages\n", n);
+		return;
+	}
+
+	for (i = 0; i < NPAGES; i++) {
+		sys_page_alloc(0, SRC_ADDR + i * PGSIZE, PTE_P | PTE_W | PTE_U);
+		SRC_ADDR[i * PGSIZE] = i;
+	}
+	ipc_send_pages(who, 0, SRC_ADDR, NPAGES, PTE_P | PTE_W | PTE_U | IPC_MOVE);
+	for (i = 0; i < NPAGES; i++)
+		if (uvpt[PGNUM(SRC_ADDR + i * PGSIZE)] & PTE_P)
+			panic("page %d still mapped after move", i);
+	cprintf("parent pages moved\n");
+}
@@ -0,0 +1,26 @@
+// Test sys_time_ns and sys_sleep.
+
+#include <inc/lib.h>
+
+#define MS	1000000ULL
+
+void
+umain(int argc, char **argv)
+{
+	uint64_t t0, t1, t2;
+	int i;
+
+	t0 = sys_time_ns();
+	t1 = sys_time_ns();
+	if (t1 < t0)
+		panic("time went backwards");
+
+	for (i = 0; i < 3; i++) {
+		t1 = sys_time_ns();
+		sys_sleep(20 * MS);
+		t2 = sys_time_ns();
+		if (t2 - t1 < 20 * MS)
+			panic("slept only %u us", (uint32_t) ((t2 - t1) / 1000));
+	}
+	cprintf("sleep ok\n");
+}
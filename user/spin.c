@@ -1,5 +1,5 @@
 // Test preemption by forking off a child process that just spins forever.
-// Let it run for a couple time slices, then kill it.
+// Let it run for a few time slices while we sleep, then kill it.
 
 #include <inc/lib.h>
 
@@ -16,14 +16,7 @@ umain(int argc, char **argv)
 	}
 
 	cprintf("I am the parent.  Running the child...\n");
-	sys_yield();
-	sys_yield();
-	sys_yield();
-	sys_yield();
-	sys_yield();
-	sys_yield();
-	sys_yield();
-	sys_yield();
+	sys_sleep(50 * 1000000);
 
 	cprintf("I am the parent.  Killing the child...\n");
 	sys_env_destroy(env);
@@ -0,0 +1,33 @@
+// Record syscall latencies and read back the histograms.
+
+#include <inc/lib.h>
+
+#define NCALL	100
+
+void
+umain(int argc, char **argv)
+{
+	uint32_t hist[SYSLAT_NBUCKET], n;
+	int i, r;
+
+	if ((r = sys_syslat(-1, 0, 0)) != -E_INVAL)
+		panic("bad op: got %e", r);
+	if ((r = sys_syslat(SYSLAT_READ, NSYSCALLS, hist)) != -E_INVAL)
+		panic("bad syscall number: got %e", r);
+
+	sys_syslat(SYSLAT_START, 0, 0);
+	for (i = 0; i < NCALL; i++)
+		sys_getenvid();
+	sys_syslat(SYSLAT_STOP, 0, 0);
+
+	if ((r = sys_syslat(SYSLAT_READ, SYS_getenvid, hist)) < NCALL)
+		panic("%d getenvid calls recorded", r);
+	for (i = n = 0; i < SYSLAT_NBUCKET; i++)
+		n += hist[i];
+	if (n != r)
+		panic("histogram holds %u calls, not %d", n, r);
+	if ((r = sys_syslat(SYSLAT_READ, SYS_page_alloc, hist)) != 0)
+		panic("%d page_alloc calls recorded", r);
+	sys_syslat(SYSLAT_REPORT, NSYSCALLS, 0);
+	cprintf("syslat ok\n");
+}
@@ -0,0 +1,44 @@
+// Test that a CPU that has turned its periodic tick off still wakes a
+// sleeping env on time, both when the env is alone and when another
+// env is spinning on the same CPU.
+
+#include <inc/lib.h>
+
+#define MS	1000000ULL
+#define NAP	(20 * MS)
+#define LATE	(50 * MS)	// How late a wakeup may be
+
+static void
+check_sleep(const char *what)
+{
+	uint64_t t1, t2;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		t1 = sys_time_ns();
+		sys_sleep(NAP);
+		t2 = sys_time_ns();
+		if (t2 - t1 > NAP + LATE)
+			panic("%s: slept %u us", what,
+			      (uint32_t) ((t2 - t1) / 1000));
+	}
+}
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	int r;
+
+	// Run on CPU 1 only, so that CPU 0 stays idle.
+	if ((r = sys_env_set_affinity(0, 1 << 1)) < 0)
+		panic("sys_env_set_affinity: %e", r);
+	check_sleep("alone");
+
+	if ((who = fork()) == 0)
+		while (1)
+			/* spin */;
+	check_sleep("with a spinner");
+	sys_env_destroy(who);
+	cprintf("tickless ok\n");
+}
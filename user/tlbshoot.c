@@ -0,0 +1,42 @@
+// Test that unmapping a page from an env running on another CPU
+// takes effect there right away.
+
+#include <inc/lib.h>
+
+#define ADDR	((volatile int *) 0xc00000)
+
+static void
+handler(struct UTrapframe *utf)
+{
+	if (utf->utf_fault_va != (uintptr_t) ADDR)
+		panic("unexpected fault at %08x", utf->utf_fault_va);
+	cprintf("child faulted after unmap\n");
+	exit();
+}
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	int r;
+
+	if ((r = sys_page_alloc(0, (void *) ADDR, PTE_P | PTE_U | PTE_W)) < 0)
+		panic("sys_page_alloc: %e", r);
+	*ADDR = 1;
+
+	if ((who = fork()) == 0) {
+		set_pgfault_handler(handler);
+		while (*ADDR)
+			;
+		panic("read 0 from unmapped page");
+	}
+
+	// Wait for the child to be spinning on another CPU.
+	while (envs[ENVX(who)].env_status != ENV_RUNNING)
+		sys_yield();
+	if ((r = sys_page_unmap(who, (void *) ADDR)) < 0)
+		panic("sys_page_unmap: %e", r);
+	while (envs[ENVX(who)].env_status != ENV_FREE)
+		sys_yield();
+	cprintf("parent done\n");
+}
@@ -0,0 +1,31 @@
+// Trace an IPC ping-pong and dump the trace buffers.
+
+#include <inc/lib.h>
+
+#define NROUND	10
+
+void
+umain(int argc, char **argv)
+{
+	envid_t who;
+	uint32_t i;
+	int r;
+
+	if ((r = sys_trace(-1)) != -E_INVAL)
+		panic("bad op: got %e", r);
+
+	sys_trace(TRACE_START);
+	if ((who = fork()) == 0) {
+		for (i = 0; i < NROUND; i++)
+			ipc_send(thisenv->env_parent_id, ipc_recv(0, 0, 0), 0, 0);
+		return;
+	}
+	for (i = 0; i < NROUND; i++) {
+		ipc_send(who, i, 0, 0);
+		if (ipc_recv(0, 0, 0) != i)
+			panic("got wrong value");
+	}
+	sys_trace(TRACE_STOP);
+	sys_trace(TRACE_DUMP);
+	cprintf("trace ok\n");
+}